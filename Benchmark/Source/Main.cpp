@@ -0,0 +1,875 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+
+    Headless offline render and benchmark for WeirdEffectsAudioProcessor.
+
+    Streams a WAV file or a synthetic signal through prepareToPlay/processBlock for
+    every sample rate / block size combination and prints the timings as JSON.
+
+    With --batch it renders many files instead, one processor per file spread over
+    a pool of worker threads.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "BiquadCascade.h"
+
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+    struct Options {
+        juce::File input, output, impulseResponse;
+        juce::String signal{ "noise" };
+        double seconds{ 10.0 }, warmupSeconds{ 1.0 };
+        juce::Array<double> sampleRates;
+        juce::Array<int> blockSizes;
+        int numChannels{ 2 };
+        bool doublePrecision{ false };
+        juce::StringPairArray parameters;
+        juce::StringArray automated;
+        //Parameters whose values are each benchmarked in turn, every combination of them
+        juce::Array<std::pair<juce::String, juce::StringArray>> sweeps;
+
+        //Batch mode
+        juce::Array<juce::File> batchInputs;
+        juce::File outputDirectory;
+        int numJobs{ juce::SystemStats::getNumCpus() };
+
+        //Runs this self test instead ("all" for every one), for ctest
+        juce::String test;
+    };
+
+    void printUsage() {
+        std::cerr
+            << "Usage: WeirdEffectsBenchmark [options]\n"
+            << "  --input <file.wav>        process a WAV file instead of a synthetic signal\n"
+            << "  --signal <type>           noise | sine | sweep | impulse | silence (default noise)\n"
+            << "  --seconds <n>             length of the synthetic signal (default 10)\n"
+            << "  --warmup <n>              seconds processed before timing starts (default 1)\n"
+            << "  --sample-rates <a,b,..>   e.g. 44100,48000,96000 (default 48000 or the file's rate)\n"
+            << "  --block-sizes <a,b,..>    e.g. 32,128,512 (default 512)\n"
+            << "  --channels <n>            channel count for synthetic signals (default 2)\n"
+            << "  --double                  process in double precision, like a 64 bit host\n"
+            << "  --param \"<id>=<value>\"    set a parameter before preparing, can be repeated\n"
+            << "  --automate \"<id>\"         sweep a parameter across its range at 0.5Hz, can be repeated\n"
+            << "  --sweep \"<id>=<a,b,..>\"     run everything once per value, can be repeated for every combination\n"
+            << "  --ir <file.wav>           impulse response for \"Reverb Mode=1\" (convolution)\n"
+            << "  --output <file.wav>       write the render of the first configuration\n"
+            << "\n"
+            << "Batch rendering:\n"
+            << "  --batch <file|folder>     render a file, or every .wav in a folder, can be repeated\n"
+            << "  --output-dir <folder>     where batch renders go, named like their input\n"
+            << "  --jobs <n>                files rendered at once (default: number of cores)\n"
+            << "  Uses the first --block-sizes entry, --param, --ir and --double apply to every file.\n"
+            << "\n"
+            << "  --test <name|all>         run a self test instead, exits 1 if it fails:\n"
+            << "                            latency, unity-gain, simd-scalar\n";
+    }
+
+    bool parseOptions(const juce::StringArray& args, Options& options, juce::String& error) {
+        for (int i = 0; i < args.size(); ++i) {
+            auto& arg = args[i];
+
+            auto next = [&]() -> juce::String {
+                if (i + 1 >= args.size()) {
+                    error = "Missing value for " + arg;
+                    return {};
+                }
+                return args[++i];
+            };
+
+            if (arg == "--input")              options.input = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+            else if (arg == "--output")        options.output = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+            else if (arg == "--ir")            options.impulseResponse = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+            else if (arg == "--signal")        options.signal = next();
+            else if (arg == "--seconds")       options.seconds = next().getDoubleValue();
+            else if (arg == "--warmup")        options.warmupSeconds = next().getDoubleValue();
+            else if (arg == "--channels")      options.numChannels = next().getIntValue();
+            else if (arg == "--double")        options.doublePrecision = true;
+            else if (arg == "--sample-rates") {
+                for (auto& rate : juce::StringArray::fromTokens(next(), ",", {}))
+                    options.sampleRates.add(rate.getDoubleValue());
+            }
+            else if (arg == "--block-sizes") {
+                for (auto& size : juce::StringArray::fromTokens(next(), ",", {}))
+                    options.blockSizes.add(size.getIntValue());
+            }
+            else if (arg == "--param") {
+                auto assignment = next();
+                options.parameters.set(assignment.upToFirstOccurrenceOf("=", false, false).trim(),
+                                       assignment.fromFirstOccurrenceOf("=", false, false).trim());
+            }
+            else if (arg == "--automate") {
+                options.automated.addIfNotAlreadyThere(next().trim());
+            }
+            else if (arg == "--sweep") {
+                auto assignment = next();
+                options.sweeps.add({ assignment.upToFirstOccurrenceOf("=", false, false).trim(),
+                                     juce::StringArray::fromTokens(assignment.fromFirstOccurrenceOf("=", false, false), ",", {}) });
+            }
+            else if (arg == "--batch") {
+                auto path = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+
+                if (path.isDirectory()) {
+                    auto files = path.findChildFiles(juce::File::findFiles, false, "*.wav");
+                    files.sort();
+                    options.batchInputs.addArray(files);
+                }
+                else {
+                    options.batchInputs.add(path);
+                }
+            }
+            else if (arg == "--output-dir")    options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile(next());
+            else if (arg == "--jobs")          options.numJobs = next().getIntValue();
+            else if (arg == "--test")          options.test = next();
+            else {
+                error = "Unknown option " + arg;
+            }
+
+            if (error.isNotEmpty())
+                return false;
+        }
+
+        if (options.blockSizes.isEmpty())
+            options.blockSizes.add(512);
+
+        for (auto blockSize : options.blockSizes) {
+            if (blockSize <= 0) {
+                error = "Block sizes must be positive";
+                return false;
+            }
+        }
+
+        for (auto sampleRate : options.sampleRates) {
+            if (sampleRate <= 0.0) {
+                error = "Sample rates must be positive";
+                return false;
+            }
+        }
+
+        if (options.numChannels < 1 || options.numChannels > WeirdEffectsAudioProcessor::maxChannels || options.seconds <= 0.0) {
+            error = "Channels must be 1-" + juce::String(WeirdEffectsAudioProcessor::maxChannels) + " and seconds positive";
+            return false;
+        }
+
+        if (!options.batchInputs.isEmpty() && (options.outputDirectory == juce::File() || options.numJobs < 1)) {
+            error = "--batch needs --output-dir and at least one job";
+            return false;
+        }
+
+        //A render deletes its output before writing it, with the input still mapped for reading
+        for (auto& input : options.batchInputs) {
+            if (input.isAChildOf(options.outputDirectory)) {
+                error = "--output-dir can't be where a --batch input is (" + input.getFullPathName() + ")";
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //Fills a buffer with one of the synthetic test signals
+    juce::AudioBuffer<float> makeSignal(const juce::String& type, int numChannels, int numSamples, double sampleRate) {
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+        buffer.clear();
+
+        //Fixed seed so every run and every build processes the same noise
+        juce::Random random(0x5eed);
+
+        for (int c = 0; c < numChannels; ++c) {
+            auto* samples = buffer.getWritePointer(c);
+
+            for (int i = 0; i < numSamples; ++i) {
+                auto time = (double)i / sampleRate;
+
+                if (type == "noise")
+                    samples[i] = random.nextFloat() * 0.5f - 0.25f;
+                else if (type == "sine")
+                    samples[i] = 0.5f * (float)std::sin(juce::MathConstants<double>::twoPi * 440.0 * time);
+                else if (type == "sweep") {
+                    //Exponential 20Hz -> 20kHz over the whole signal
+                    auto duration = (double)numSamples / sampleRate;
+                    auto rate = std::log(1000.0) / duration;
+                    auto phase = juce::MathConstants<double>::twoPi * 20.0 * (std::exp(rate * time) - 1.0) / rate;
+                    samples[i] = 0.5f * (float)std::sin(phase);
+                }
+                else if (type == "impulse")
+                    samples[i] = (i % (int)sampleRate) == 0 ? 1.f : 0.f;
+            }
+        }
+
+        return buffer;
+    }
+
+    bool loadWav(const juce::File& file, juce::AudioBuffer<float>& buffer, double& fileSampleRate) {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+        if (reader == nullptr)
+            return false;
+
+        buffer.setSize((int)reader->numChannels, (int)reader->lengthInSamples);
+        reader->read(&buffer, 0, (int)reader->lengthInSamples, 0, true, true);
+        fileSampleRate = reader->sampleRate;
+        return true;
+    }
+
+    bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& buffer, double sampleRate) {
+        file.deleteFile();
+
+        auto stream = file.createOutputStream();
+        if (stream == nullptr)
+            return false;
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate,
+                                                                            (unsigned int)buffer.getNumChannels(),
+                                                                            24, {}, 0));
+        if (writer == nullptr)
+            return false;
+
+        //The writer owns the stream now
+        stream.release();
+        return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+    }
+
+    void applyParameters(WeirdEffectsAudioProcessor& processor, const juce::StringPairArray& parameters) {
+        for (auto& id : parameters.getAllKeys()) {
+            if (auto* parameter = processor.valueTree.getParameter(id))
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(parameters[id].getFloatValue()));
+            else
+                std::cerr << "Unknown parameter " << id << ", ignoring\n";
+        }
+    }
+
+    //What a host does for automation: moves each parameter right before the block it applies
+    //to. A 0.5Hz sine over the whole normalised range, so the cut frequencies keep gliding.
+    void automateParameters(const juce::Array<juce::RangedAudioParameter*>& automated, int position, double sampleRate) {
+        auto phase = juce::MathConstants<double>::twoPi * 0.5 * (double)position / sampleRate;
+
+        for (auto* parameter : automated)
+            parameter->setValueNotifyingHost((float)(0.5 + 0.5 * std::sin(phase)));
+    }
+
+    //Copies (and converts, for double runs) length samples of every channel
+    template <typename Destination, typename Source>
+    void copySamples(juce::AudioBuffer<Destination>& destination, int destinationStart,
+                     const juce::AudioBuffer<Source>& source, int sourceStart, int length) {
+        for (int c = 0; c < destination.getNumChannels(); ++c) {
+            auto* from = source.getReadPointer(c, sourceStart);
+            std::copy(from, from + length, destination.getWritePointer(c, destinationStart));
+        }
+    }
+
+    //Parameters, impulse response, bus layout and precision from the options, then prepareToPlay.
+    //Always non-realtime, so the convolution tail runs inline and renders are deterministic.
+    template <typename SampleType>
+    void prepareProcessor(WeirdEffectsAudioProcessor& processor, int numChannels, double sampleRate, int blockSize, const Options& options) {
+        applyParameters(processor, options.parameters);
+
+        //Loaded before prepareToPlay, which builds the partitions synchronously
+        if (options.impulseResponse != juce::File() && !processor.loadImpulseResponse(options.impulseResponse))
+            std::cerr << "Couldn't read " << options.impulseResponse.getFullPathName() << ", using the built-in impulse response\n";
+
+        juce::AudioProcessor::BusesLayout layout;
+        //The usual layout for that many channels (LCR, 5.1, 7.1...), or plain discrete channels
+        auto channelSet = juce::AudioChannelSet::canonicalChannelSet(numChannels);
+        if (channelSet.isDisabled())
+            channelSet = juce::AudioChannelSet::discreteChannels(numChannels);
+        layout.inputBuses.add(channelSet);
+        layout.outputBuses.add(channelSet);
+        processor.setBusesLayout(layout);
+        processor.setPlayConfigDetails(numChannels, numChannels, sampleRate, blockSize);
+        processor.setNonRealtime(true);
+        processor.setProcessingPrecision(std::is_same_v<SampleType, double> ? juce::AudioProcessor::doublePrecision
+                                                                            : juce::AudioProcessor::singlePrecision);
+        processor.prepareToPlay(sampleRate, blockSize);
+    }
+
+    //Runs the whole source through a fresh processor and returns the timings as a JSON object.
+    //If render isn't null the processed audio is copied into it. SampleType picks the precision
+    //processBlock runs in, the source and render stay float either way.
+    template <typename SampleType>
+    juce::var runBenchmark(const juce::AudioBuffer<float>& source, double sampleRate, int blockSize,
+                           const Options& options, juce::AudioBuffer<float>* render) {
+        auto numChannels = source.getNumChannels();
+        auto numSamples = source.getNumSamples();
+
+        WeirdEffectsAudioProcessor processor;
+        prepareProcessor<SampleType>(processor, numChannels, sampleRate, blockSize, options);
+
+        juce::Array<juce::RangedAudioParameter*> automated;
+        for (auto& id : options.automated) {
+            if (auto* parameter = processor.valueTree.getParameter(id))
+                automated.add(parameter);
+            else
+                std::cerr << "Unknown parameter " << id << ", not automating it\n";
+        }
+
+        juce::AudioBuffer<SampleType> buffer(numChannels, blockSize);
+        juce::MidiBuffer midi;
+
+        //Warm the caches and let smoothed values settle before anything is timed,
+        //looping over the start of the source if it is shorter than the warmup
+        auto warmupSamples = (int)(options.warmupSeconds * sampleRate);
+        for (int position = 0; position < warmupSamples;) {
+            auto start = position % numSamples;
+            auto length = juce::jmin(blockSize, numSamples - start, warmupSamples - position);
+            buffer.setSize(numChannels, length, false, false, true);
+            copySamples(buffer, 0, source, start, length);
+            automateParameters(automated, position, sampleRate);
+            processor.processBlock(buffer, midi);
+            position += length;
+        }
+        processor.reset();
+        processor.getRealtimeMonitor().reset();
+        auto sleptBeforeTiming = processor.getSleptBlocks();
+
+        if (render != nullptr)
+            render->setSize(numChannels, numSamples);
+
+        std::vector<double> blockNanoseconds;
+        blockNanoseconds.reserve((size_t)(numSamples / blockSize + 1));
+        double totalNanoseconds = 0.0;
+
+        for (int position = 0; position < numSamples; position += blockSize) {
+            auto length = juce::jmin(blockSize, numSamples - position);
+            buffer.setSize(numChannels, length, false, false, true);
+            copySamples(buffer, 0, source, position, length);
+            //Outside the timed region, only the processor's reaction to the change counts
+            automateParameters(automated, position, sampleRate);
+
+            auto start = std::chrono::steady_clock::now();
+            processor.processBlock(buffer, midi);
+            auto end = std::chrono::steady_clock::now();
+
+            auto nanoseconds = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            blockNanoseconds.push_back(nanoseconds);
+            totalNanoseconds += nanoseconds;
+
+            if (render != nullptr)
+                copySamples(*render, position, buffer, 0, length);
+        }
+
+        processor.releaseResources();
+
+        std::sort(blockNanoseconds.begin(), blockNanoseconds.end());
+        auto percentile = [&blockNanoseconds](double fraction) {
+            auto index = juce::jmin(blockNanoseconds.size() - 1, (size_t)(fraction * (double)blockNanoseconds.size()));
+            return blockNanoseconds[index] / 1000.0;
+        };
+
+        auto audioSeconds = (double)numSamples / sampleRate;
+
+        auto* blockTimes = new juce::DynamicObject();
+        blockTimes->setProperty("p50", percentile(0.5));
+        blockTimes->setProperty("p99", percentile(0.99));
+        blockTimes->setProperty("max", blockNanoseconds.back() / 1000.0);
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("sampleRate", sampleRate);
+        result->setProperty("blockSize", blockSize);
+        result->setProperty("channels", numChannels);
+        result->setProperty("precision", std::is_same_v<SampleType, double> ? "double" : "float");
+        result->setProperty("automated", juce::var(options.automated));
+
+        auto* parameterValues = new juce::DynamicObject();
+        for (auto& id : options.parameters.getAllKeys())
+            parameterValues->setProperty(id, options.parameters[id].getFloatValue());
+        result->setProperty("parameters", juce::var(parameterValues));
+        result->setProperty("samples", numSamples);
+        result->setProperty("blocks", (int)blockNanoseconds.size());
+        result->setProperty("nsPerSample", totalNanoseconds / (double)numSamples);
+        result->setProperty("realtimeFactor", audioSeconds / (totalNanoseconds * 1.0e-9));
+        result->setProperty("blockTimeUs", juce::var(blockTimes));
+        result->setProperty("sleptBlocks", (juce::int64)(processor.getSleptBlocks() - sleptBeforeTiming));
+
+        //Only meaningful when built with -DWEIRDEFFECTS_REALTIME_CHECKS=ON
+        if (RealtimeSafety::isEnabled()) {
+            auto totals = processor.getRealtimeMonitor().getTotals();
+
+            auto* safety = new juce::DynamicObject();
+            safety->setProperty("allocations", (juce::int64)totals.allocations);
+            safety->setProperty("deallocations", (juce::int64)totals.deallocations);
+            safety->setProperty("locks", (juce::int64)totals.locks);
+            safety->setProperty("blocksWithViolations", (juce::int64)totals.blocksWithViolations);
+            result->setProperty("realtimeSafety", juce::var(safety));
+        }
+
+        return juce::var(result);
+    }
+
+    //Streams one file through its own processor, blockSize samples at a time, straight into the
+    //output file. WAV inputs are memory mapped, so the OS pages them in and out as the render
+    //moves along, and only one block of audio is ever held in our own buffers. Memory use stays
+    //the same however long the file is.
+    //
+    //The output lines up with the input: the processor's latency is cut off the start, and
+    //silence is fed in after the input until the delayed signal and the tail are all out.
+    template <typename SampleType>
+    juce::var renderFile(const juce::File& input, const juce::File& output, int blockSize, const Options& options) {
+        auto* result = new juce::DynamicObject();
+        result->setProperty("input", input.getFullPathName());
+
+        auto fail = [result](const juce::String& message) {
+            result->setProperty("error", message);
+            return juce::var(result);
+        };
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatReader> reader;
+
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(wav.createMemoryMappedReader(input));
+        if (mapped != nullptr && mapped->mapEntireFile()) {
+            reader = std::move(mapped);
+        }
+        else {
+            //Not a WAV, or it couldn't be mapped: a regular reader streams just as well, only with a copy
+            juce::AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+            reader.reset(formatManager.createReaderFor(input));
+        }
+
+        if (reader == nullptr || reader->numChannels == 0)
+            return fail("Couldn't read the input");
+
+        if (reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+            return fail("The input has no audio");
+
+        auto numChannels = juce::jmin((int)reader->numChannels, WeirdEffectsAudioProcessor::maxChannels);
+        auto numSamples = reader->lengthInSamples;
+        auto sampleRate = reader->sampleRate;
+
+        output.deleteFile();
+        auto stream = output.createOutputStream();
+        if (stream == nullptr)
+            return fail("Couldn't create the output");
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, (unsigned int)numChannels, 24, {}, 0));
+        if (writer == nullptr)
+            return fail("Couldn't create a WAV writer");
+
+        //The writer owns the stream now
+        stream.release();
+
+        WeirdEffectsAudioProcessor processor;
+        prepareProcessor<SampleType>(processor, numChannels, sampleRate, blockSize, options);
+
+        //Files are float on both ends, the processing precision is whatever the options say
+        juce::AudioBuffer<float> io(numChannels, blockSize);
+        juce::AudioBuffer<SampleType> buffer(numChannels, blockSize);
+        juce::MidiBuffer midi;
+
+        auto latency = (juce::int64)processor.getLatencySamples();
+        auto tail = (juce::int64)std::ceil(processor.getTailLengthSeconds() * sampleRate);
+        auto numProcessed = numSamples + latency + tail;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (juce::int64 position = 0; position < numProcessed; position += blockSize) {
+            auto length = (int)juce::jmin((juce::int64)blockSize, numProcessed - position);
+            io.setSize(numChannels, length, false, false, true);
+            buffer.setSize(numChannels, length, false, false, true);
+
+            io.clear();
+            auto fromFile = (int)juce::jlimit((juce::int64)0, (juce::int64)length, numSamples - position);
+            if (fromFile > 0)
+                reader->read(&io, 0, fromFile, position, true, true);
+
+            copySamples(buffer, 0, io, 0, length);
+            processor.processBlock(buffer, midi);
+            copySamples(io, 0, buffer, 0, length);
+
+            //Whatever is still inside the latency at the start isn't part of the render
+            auto skip = (int)juce::jlimit((juce::int64)0, (juce::int64)length, latency - position);
+            if (skip < length && !writer->writeFromAudioSampleBuffer(io, skip, length - skip))
+                return fail("Couldn't write the output");
+        }
+
+        processor.releaseResources();
+        writer.reset();
+
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        auto audioSeconds = (double)numSamples / sampleRate;
+
+        result->setProperty("output", output.getFullPathName());
+        result->setProperty("channels", numChannels);
+        result->setProperty("sampleRate", sampleRate);
+        result->setProperty("samples", numSamples);
+        result->setProperty("latencySamples", latency);
+        result->setProperty("tailSamples", tail);
+        result->setProperty("seconds", seconds);
+        result->setProperty("realtimeFactor", seconds > 0.0 ? audioSeconds / seconds : 0.0);
+        return juce::var(result);
+    }
+
+    //Renders a single impulse through renderFile with the linear phase cuts, which add the most
+    //latency, and checks it comes out at sample 0 of a render that also has the tail.
+    //Returns the failure, or an empty string when it passed.
+    juce::String testLatencyCompensation(const Options& options) {
+        const double sampleRate = 48000.0;
+        const int numSamples = (int)sampleRate;
+
+        juce::TemporaryFile input(".wav"), output(".wav");
+
+        juce::AudioBuffer<float> impulse(2, numSamples);
+        impulse.clear();
+        for (int c = 0; c < impulse.getNumChannels(); ++c)
+            impulse.setSample(c, 0, 0.5f);
+
+        if (!writeWav(input.getFile(), impulse, sampleRate))
+            return "Couldn't write the test input";
+
+        auto testOptions = options;
+        testOptions.parameters.set("Cut Mode", "2");
+        testOptions.parameters.set("Dry/Wet", "100");
+
+        auto result = testOptions.doublePrecision ? renderFile<double>(input.getFile(), output.getFile(), options.blockSizes.getFirst(), testOptions)
+                                                  : renderFile<float>(input.getFile(), output.getFile(), options.blockSizes.getFirst(), testOptions);
+        if (result.hasProperty("error"))
+            return result["error"].toString();
+
+        if ((int)result["latencySamples"] == 0)
+            return "Linear Phase reported no latency, nothing was tested";
+
+        juce::AudioBuffer<float> render;
+        double renderSampleRate = 0.0;
+        if (!loadWav(output.getFile(), render, renderSampleRate))
+            return "Couldn't read the render";
+
+        auto expectedLength = numSamples + (int)result["tailSamples"];
+        if (render.getNumSamples() != expectedLength)
+            return "Render is " + juce::String(render.getNumSamples()) + " samples, expected " + juce::String(expectedLength);
+
+        for (int c = 0; c < render.getNumChannels(); ++c) {
+            auto* samples = render.getReadPointer(c);
+            auto peak = (int)(std::max_element(samples, samples + render.getNumSamples(),
+                                               [](float a, float b) { return std::abs(a) < std::abs(b); }) - samples);
+            if (peak != 0)
+                return "Channel " + juce::String(c) + " peaks at sample " + juce::String(peak) + " instead of 0";
+        }
+
+        return {};
+    }
+
+    //Renders noise through renderFile with every parameter at its default and checks the
+    //output is the input, so inserting the plugin doesn't change the level.
+    juce::String testDefaultsAreUnityGain(const Options& options) {
+        const double sampleRate = 48000.0;
+        auto noise = makeSignal("noise", 2, (int)sampleRate, sampleRate);
+
+        juce::TemporaryFile input(".wav"), output(".wav");
+        if (!writeWav(input.getFile(), noise, sampleRate))
+            return "Couldn't write the test input";
+
+        //What was actually written, 24 bit
+        juce::AudioBuffer<float> source, render;
+        double fileSampleRate = 0.0;
+        if (!loadWav(input.getFile(), source, fileSampleRate))
+            return "Couldn't read the test input back";
+
+        auto defaults = options;
+        defaults.parameters.clear();
+
+        auto result = defaults.doublePrecision ? renderFile<double>(input.getFile(), output.getFile(), options.blockSizes.getFirst(), defaults)
+                                               : renderFile<float>(input.getFile(), output.getFile(), options.blockSizes.getFirst(), defaults);
+        if (result.hasProperty("error"))
+            return result["error"].toString();
+
+        if (!loadWav(output.getFile(), render, fileSampleRate) || render.getNumSamples() < source.getNumSamples())
+            return "Couldn't read the render";
+
+        for (int c = 0; c < source.getNumChannels(); ++c) {
+            auto sourceLevel = source.getRMSLevel(c, 0, source.getNumSamples());
+            auto renderLevel = render.getRMSLevel(c, 0, source.getNumSamples());
+            auto gainDecibels = juce::Decibels::gainToDecibels(renderLevel / sourceLevel);
+
+            if (std::abs(gainDecibels) > 0.01f)
+                return "Channel " + juce::String(c) + " comes out " + juce::String(gainDecibels, 3) + "dB";
+
+            for (int i = 0; i < source.getNumSamples(); ++i)
+                if (std::abs(render.getSample(c, i) - source.getSample(c, i)) > 1.0e-4f)
+                    return "Channel " + juce::String(c) + " differs from the input at sample " + juce::String(i);
+        }
+
+        return {};
+    }
+
+    //Runs noise through two BiquadCascades, one forced onto the scalar fallback, with the slopes
+    //changing every block so sections come and go, and checks they agree bit for bit.
+    template <typename SampleType>
+    juce::String compareCascadePaths(int numChannels) {
+        const double sampleRate = 48000.0;
+        const int blockSize = 512, numBlocks = 64;
+
+        juce::dsp::ProcessSpec spec{ sampleRate, (juce::uint32)blockSize, (juce::uint32)numChannels };
+        BiquadCascade<SampleType> simd, scalar;
+        simd.prepare(spec);
+        scalar.prepare(spec);
+        scalar.setUseScalarFallback(true);
+
+        auto noise = makeSignal("noise", numChannels, blockSize * numBlocks, sampleRate);
+        juce::AudioBuffer<SampleType> simdBuffer(numChannels, blockSize), scalarBuffer(numChannels, blockSize);
+
+        for (int block = 0; block < numBlocks; ++block) {
+            auto lowCut = CutFilterDesign::makeLowCut(200.f, sampleRate, 1 + block % 3);
+            auto highCut = CutFilterDesign::makeHighCut(5000.f, sampleRate, 1 + (block / 3) % 3);
+            simd.setCoefficients(lowCut, highCut);
+            scalar.setCoefficients(lowCut, highCut);
+
+            copySamples(simdBuffer, 0, noise, block * blockSize, blockSize);
+            copySamples(scalarBuffer, 0, noise, block * blockSize, blockSize);
+
+            juce::dsp::AudioBlock<SampleType> simdBlock(simdBuffer), scalarBlock(scalarBuffer);
+            simd.process(juce::dsp::ProcessContextReplacing<SampleType>(simdBlock));
+            scalar.process(juce::dsp::ProcessContextReplacing<SampleType>(scalarBlock));
+
+            for (int c = 0; c < numChannels; ++c)
+                for (int i = 0; i < blockSize; ++i)
+                    if (simdBuffer.getSample(c, i) != scalarBuffer.getSample(c, i))
+                        return juce::String(numChannels) + " channels, " + (std::is_same_v<SampleType, double> ? "double" : "float")
+                             + ": channel " + juce::String(c) + " differs at sample " + juce::String(block * blockSize + i);
+        }
+
+        return {};
+    }
+
+    //The SIMD and scalar paths of BiquadCascade promise identical output. Covers a partial lane
+    //group, a full one and layouts that need several.
+    juce::String testSimdMatchesScalar(const Options&) {
+        for (auto numChannels : { 1, 2, 6, 12 }) {
+            for (auto failure : { compareCascadePaths<float>(numChannels), compareCascadePaths<double>(numChannels) })
+                if (failure.isNotEmpty())
+                    return failure;
+        }
+
+        return {};
+    }
+
+    struct SelfTest {
+        const char* name;
+        juce::String (*run)(const Options&);
+    };
+
+    const SelfTest selfTests[] = {
+        { "latency", testLatencyCompensation },
+        { "unity-gain", testDefaultsAreUnityGain },
+        { "simd-scalar", testSimdMatchesScalar },
+    };
+
+    //Runs options.test, or all of them, and prints how each one went. Returns the number of failures.
+    int runSelfTests(const Options& options) {
+        int failures = 0, ran = 0;
+
+        for (auto& test : selfTests) {
+            if (options.test != "all" && options.test != test.name)
+                continue;
+
+            ++ran;
+            auto failure = test.run(options);
+            std::cout << test.name << ": " << (failure.isEmpty() ? juce::String("passed") : failure) << std::endl;
+            if (failure.isNotEmpty())
+                ++failures;
+        }
+
+        if (ran == 0) {
+            std::cerr << "Unknown test " << options.test << "\n";
+            return 1;
+        }
+
+        return failures;
+    }
+
+    //Renders every batch input on options.numJobs threads. Every file gets its own processor and
+    //nothing is shared between jobs except the read-only coefficient table, so each output is
+    //bit identical to rendering that file alone with --jobs 1.
+    //
+    //Idle workers take the next file from the shared queue, longest files first, so the long
+    //ones don't end up last on one core while the others sit idle.
+    juce::var runBatch(const Options& options) {
+        auto blockSize = options.blockSizes.getFirst();
+
+        //Outputs are named like their input. Inputs that share a name (from different --batch
+        //folders) get " 2", " 3"... in the order they were given, so no two jobs write one file.
+        std::vector<std::pair<juce::File, juce::File>> inputs;
+        juce::StringArray outputNames;
+        for (auto& input : options.batchInputs) {
+            auto name = input.getFileNameWithoutExtension();
+            for (int n = 2; outputNames.contains(name, true); ++n)
+                name = input.getFileNameWithoutExtension() + " " + juce::String(n);
+
+            outputNames.add(name);
+            inputs.push_back({ input, options.outputDirectory.getChildFile(name + ".wav") });
+        }
+
+        std::stable_sort(inputs.begin(), inputs.end(), [](const auto& a, const auto& b) { return a.first.getSize() > b.first.getSize(); });
+
+        options.outputDirectory.createDirectory();
+
+        auto numInputs = (int)inputs.size();
+        std::vector<juce::var> results(inputs.size());
+        std::atomic<int> remaining{ numInputs };
+        juce::WaitableEvent finished;
+
+        auto wallStart = std::chrono::steady_clock::now();
+
+        {
+            juce::ThreadPool pool(juce::jmin(options.numJobs, juce::jmax(1, numInputs)));
+
+            for (int i = 0; i < numInputs; ++i) {
+                pool.addJob([&, i] {
+                    auto& [input, output] = inputs[(size_t)i];
+
+                    results[(size_t)i] = options.doublePrecision ? renderFile<double>(input, output, blockSize, options)
+                                                                 : renderFile<float>(input, output, blockSize, options);
+
+                    if (--remaining == 0)
+                        finished.signal();
+
+                    return juce::ThreadPoolJob::jobHasFinished;
+                });
+            }
+
+            if (numInputs > 0)
+                finished.wait();
+        }
+
+        auto wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+        juce::Array<juce::var> files;
+        double audioSeconds = 0.0;
+        int failures = 0;
+
+        for (auto& result : results) {
+            files.add(result);
+
+            if (result.hasProperty("error"))
+                ++failures;
+            else
+                audioSeconds += (double)result["samples"] / (double)result["sampleRate"];
+        }
+
+        auto* report = new juce::DynamicObject();
+        report->setProperty("processor", "WeirdEffects");
+        report->setProperty("mode", "batch");
+        report->setProperty("jobs", options.numJobs);
+        report->setProperty("blockSize", blockSize);
+        report->setProperty("precision", options.doublePrecision ? "double" : "float");
+        report->setProperty("wallSeconds", wallSeconds);
+        //Seconds of audio rendered per second of wall time, across all jobs
+        report->setProperty("throughput", wallSeconds > 0.0 ? audioSeconds / wallSeconds : 0.0);
+        report->setProperty("failures", failures);
+        report->setProperty("files", files);
+        return juce::var(report);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    //Parameters and the processor expect the message manager to exist, even without a window
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(argv[i]);
+
+    if (args.contains("--help") || args.contains("-h")) {
+        printUsage();
+        return 0;
+    }
+
+    Options options;
+    juce::String error;
+    if (!parseOptions(args, options, error)) {
+        std::cerr << error << "\n";
+        printUsage();
+        return 1;
+    }
+
+    if (options.test.isNotEmpty())
+        return runSelfTests(options) > 0 ? 1 : 0;
+
+    if (!options.batchInputs.isEmpty()) {
+        auto report = runBatch(options);
+        std::cout << juce::JSON::toString(report) << std::endl;
+        return (int)report["failures"] > 0 ? 1 : 0;
+    }
+
+    juce::AudioBuffer<float> fileAudio;
+    double fileSampleRate = 0.0;
+
+    if (options.input != juce::File()) {
+        if (!loadWav(options.input, fileAudio, fileSampleRate)) {
+            std::cerr << "Couldn't read " << options.input.getFullPathName() << "\n";
+            return 1;
+        }
+
+        //Anything wider than the widest bus the plugin accepts is dropped
+        if (fileAudio.getNumChannels() > WeirdEffectsAudioProcessor::maxChannels)
+            fileAudio.setSize(WeirdEffectsAudioProcessor::maxChannels, fileAudio.getNumSamples(), true);
+    }
+
+    if (options.sampleRates.isEmpty())
+        options.sampleRates.add(fileSampleRate > 0.0 ? fileSampleRate : 48000.0);
+
+    //Every combination of the --sweep values on top of the --param ones
+    juce::Array<juce::StringPairArray> parameterSets{ options.parameters };
+    for (auto& sweep : options.sweeps) {
+        juce::Array<juce::StringPairArray> expanded;
+        for (auto& parameterSet : parameterSets) {
+            for (auto& value : sweep.second) {
+                auto withValue = parameterSet;
+                withValue.set(sweep.first, value.trim());
+                expanded.add(withValue);
+            }
+        }
+        parameterSets = expanded;
+    }
+
+    juce::Array<juce::var> runs;
+    juce::AudioBuffer<float> render;
+
+    for (auto sampleRate : options.sampleRates) {
+        //File audio is processed as-is at every rate, this is about timing not resampling
+        auto source = fileSampleRate > 0.0
+                    ? fileAudio
+                    : makeSignal(options.signal, options.numChannels, (int)(options.seconds * sampleRate), sampleRate);
+
+        //The warmup loops over the source and the timings need at least one block
+        if (source.getNumSamples() == 0) {
+            std::cerr << "Nothing to process: the input is empty or --seconds is shorter than one sample\n";
+            return 1;
+        }
+
+        for (auto& parameterSet : parameterSets) {
+            auto runOptions = options;
+            runOptions.parameters = parameterSet;
+
+            for (auto blockSize : options.blockSizes) {
+                auto wantsRender = runs.isEmpty() && options.output != juce::File();
+                auto* renderTarget = wantsRender ? &render : nullptr;
+                runs.add(options.doublePrecision ? runBenchmark<double>(source, sampleRate, blockSize, runOptions, renderTarget)
+                                                 : runBenchmark<float>(source, sampleRate, blockSize, runOptions, renderTarget));
+
+                if (wantsRender && !writeWav(options.output, render, sampleRate)) {
+                    std::cerr << "Couldn't write " << options.output.getFullPathName() << "\n";
+                    return 1;
+                }
+            }
+        }
+    }
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty("processor", "WeirdEffects");
+    report->setProperty("input", options.input != juce::File() ? options.input.getFullPathName() : options.signal);
+    report->setProperty("runs", runs);
+
+    std::cout << juce::JSON::toString(juce::var(report)) << std::endl;
+    return 0;
+}
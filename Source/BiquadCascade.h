@@ -0,0 +1,264 @@
+/*
+  ==============================================================================
+
+    BiquadCascade.h
+
+    LowCut + HighCut biquads for every channel, packed into SIMD lanes.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CutFilterDesign.h"
+
+//Runs every active LowCut and HighCut section over all channels in a single pass.
+//
+//Instead of one scalar IIR::Filter per section per channel, the channels are interleaved
+//into the lanes of a juce::dsp::SIMDRegister (channel 0 -> lane 0, channel 1 -> lane 1...)
+//so one multiply handles a whole group of channels at once, and each sample goes through all
+//six sections before moving on, which keeps the filter state in registers. Layouts wider than
+//one register (5.1, 7.1.4, ambisonics...) are split into lane groups that run one after the
+//other, so the cost grows with the number of groups rather than the number of channels.
+//
+//The scalar fallback does exactly the same arithmetic in exactly the same order per lane,
+//so both paths give bit identical output as long as the compiler isn't allowed to fuse
+//multiply/adds. The plugin and benchmark builds pass /fp:precise (MSVC) or -ffp-contract=off
+//(GCC/Clang) for that.
+template <typename SampleType>
+class BiquadCascade {
+public:
+   #if JUCE_USE_SIMD
+    using Vector = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr int numLanes = static_cast<int>(Vector::SIMDNumElements);
+   #else
+    static constexpr int numLanes = 4;
+   #endif
+
+    //3 LowCut sections followed by 3 HighCut sections. Every section has a fixed slot (LowCut
+    //0-2, HighCut 3-5) and keeps its state there, whatever the other cut's slope is.
+    static constexpr int maxSections = 2 * CutCoefficients::maxSections;
+
+    BiquadCascade() = default;
+
+    //Allocates the interleave buffer and the state of every lane group, so never call this
+    //from processBlock
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        numChannels = (int)spec.numChannels;
+        numGroups = (numChannels + numLanes - 1) / numLanes;
+        maxBlockSize = (int)spec.maximumBlockSize;
+
+        //Extra room so the start can be moved up to the next SIMD aligned address. One group is
+        //interleaved at a time, so the buffer only needs to hold one.
+        interleavedMemory.calloc((size_t)(maxBlockSize * numLanes) * sizeof(SampleType) + 64);
+        interleaved = alignPointer(reinterpret_cast<SampleType*>(interleavedMemory.getData()));
+
+        stateSize = (size_t)(numGroups * maxSections * numLanes);
+        stateMemory.calloc(2 * stateSize * sizeof(SampleType) + 64);
+        state1 = alignPointer(reinterpret_cast<SampleType*>(stateMemory.getData()));
+        state2 = state1 + stateSize;
+
+        reset();
+    }
+
+    void reset() noexcept {
+        if (state1 != nullptr)
+            std::fill(state1, state1 + 2 * stateSize, SampleType(0));
+    }
+
+    //Copies in new designs. Only assigns numbers, so this is fine on the audio thread. A slot
+    //that comes back after a slope change starts from silence rather than its old state.
+    void setCoefficients(const CutCoefficients& lowCut, const CutCoefficients& highCut) noexcept {
+        juce::uint32 newMask = 0;
+
+        for (auto* cut : { &lowCut, &highCut }) {
+            auto firstSlot = cut == &lowCut ? 0 : CutCoefficients::maxSections;
+
+            for (int i = 0; i < cut->numSections; ++i) {
+                auto slot = firstSlot + i;
+                auto& source = cut->sections[(size_t)i];
+                auto& section = sections[(size_t)slot];
+
+                section.b0 = static_cast<SampleType>(source.b0);
+                section.b1 = static_cast<SampleType>(source.b1);
+                section.b2 = static_cast<SampleType>(source.b2);
+                section.a1 = static_cast<SampleType>(source.a1);
+                section.a2 = static_cast<SampleType>(source.a2);
+
+                newMask |= 1u << slot;
+                if ((activeMask & (1u << slot)) == 0)
+                    clearSlot(slot);
+            }
+        }
+
+        activeMask = newMask;
+        numActiveSections = 0;
+        for (int slot = 0; slot < maxSections; ++slot)
+            if (activeMask & (1u << slot))
+                activeSlots[(size_t)numActiveSections++] = slot;
+    }
+
+    //Forces the scalar path even when SIMD is available, handy for comparing the two
+    void setUseScalarFallback(bool shouldUseScalar) noexcept { useScalarFallback = shouldUseScalar; }
+
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept {
+        auto& block = context.getOutputBlock();
+        auto channels = juce::jmin((int)block.getNumChannels(), numChannels);
+        auto numSamples = (int)block.getNumSamples();
+
+        jassert(numSamples <= maxBlockSize);
+
+        if (context.isBypassed || numActiveSections == 0 || channels == 0)
+            return;
+
+        for (int group = 0; group * numLanes < channels; ++group) {
+            auto firstChannel = group * numLanes;
+            auto groupChannels = juce::jmin(numLanes, channels - firstChannel);
+
+           #if JUCE_USE_SIMD
+            if (!useScalarFallback) {
+                processSIMD(block, group, firstChannel, groupChannels, numSamples);
+                continue;
+            }
+           #endif
+
+            processScalar(block, group, firstChannel, groupChannels, numSamples);
+        }
+    }
+
+private:
+    struct Section {
+        SampleType b0{ 1 }, b1{ 0 }, b2{ 0 }, a1{ 0 }, a2{ 0 };
+    };
+
+    void clearSlot(int slot) noexcept {
+        if (state1 == nullptr)
+            return;
+
+        for (int group = 0; group < numGroups; ++group) {
+            auto offset = (size_t)((group * maxSections + slot) * numLanes);
+            std::fill(state1 + offset, state1 + offset + numLanes, SampleType(0));
+            std::fill(state2 + offset, state2 + offset + numLanes, SampleType(0));
+        }
+    }
+
+    static SampleType* alignPointer(SampleType* pointer) noexcept {
+       #if JUCE_USE_SIMD
+        return Vector::getNextSIMDAlignedPtr(pointer);
+       #else
+        return pointer;
+       #endif
+    }
+
+   #if JUCE_USE_SIMD
+    void processSIMD(juce::dsp::AudioBlock<SampleType>& block, int group, int firstChannel, int channels, int numSamples) noexcept {
+        //Channel firstChannel + c goes into lane c of every frame. Unused lanes of a partial
+        //group are zeroed so they filter silence instead of the previous group's leftovers.
+        for (int c = 0; c < numLanes; ++c) {
+            if (c < channels) {
+                auto* source = block.getChannelPointer((size_t)(firstChannel + c));
+                for (int i = 0; i < numSamples; ++i)
+                    interleaved[i * numLanes + c] = source[i];
+            }
+            else {
+                for (int i = 0; i < numSamples; ++i)
+                    interleaved[i * numLanes + c] = SampleType(0);
+            }
+        }
+
+        auto* groupState1 = state1 + (size_t)(group * maxSections * numLanes);
+        auto* groupState2 = state2 + (size_t)(group * maxSections * numLanes);
+
+        //Coefficients and state of the active slots live in registers for the whole block
+        std::array<Vector, maxSections> b0, b1, b2, a1, a2, s1, s2;
+        for (int s = 0; s < numActiveSections; ++s) {
+            auto slot = activeSlots[(size_t)s];
+            auto& section = sections[(size_t)slot];
+            b0[(size_t)s] = Vector::expand(section.b0);
+            b1[(size_t)s] = Vector::expand(section.b1);
+            b2[(size_t)s] = Vector::expand(section.b2);
+            a1[(size_t)s] = Vector::expand(section.a1);
+            a2[(size_t)s] = Vector::expand(section.a2);
+            s1[(size_t)s] = Vector::fromRawArray(groupState1 + slot * numLanes);
+            s2[(size_t)s] = Vector::fromRawArray(groupState2 + slot * numLanes);
+        }
+
+        for (int i = 0; i < numSamples; ++i) {
+            auto* frame = interleaved + i * numLanes;
+            auto x = Vector::fromRawArray(frame);
+
+            //Transposed direct form II, the same as IIR::Filter
+            for (size_t s = 0; s < (size_t)numActiveSections; ++s) {
+                auto y = (b0[s] * x) + s1[s];
+                s1[s] = (b1[s] * x) - (a1[s] * y) + s2[s];
+                s2[s] = (b2[s] * x) - (a2[s] * y);
+                x = y;
+            }
+
+            x.copyToRawArray(frame);
+        }
+
+        for (int s = 0; s < numActiveSections; ++s) {
+            auto slot = activeSlots[(size_t)s];
+            s1[(size_t)s].copyToRawArray(groupState1 + slot * numLanes);
+            s2[(size_t)s].copyToRawArray(groupState2 + slot * numLanes);
+        }
+
+        for (int c = 0; c < channels; ++c) {
+            auto* destination = block.getChannelPointer((size_t)(firstChannel + c));
+            for (int i = 0; i < numSamples; ++i)
+                destination[i] = interleaved[i * numLanes + c];
+        }
+    }
+   #endif
+
+    void processScalar(juce::dsp::AudioBlock<SampleType>& block, int group, int firstChannel, int channels, int numSamples) noexcept {
+        auto* groupState1 = state1 + (size_t)(group * maxSections * numLanes);
+        auto* groupState2 = state2 + (size_t)(group * maxSections * numLanes);
+
+        for (int c = 0; c < channels; ++c) {
+            auto* samples = block.getChannelPointer((size_t)(firstChannel + c));
+
+            for (int i = 0; i < numSamples; ++i) {
+                auto x = samples[i];
+
+                for (int s = 0; s < numActiveSections; ++s) {
+                    auto slot = activeSlots[(size_t)s];
+                    auto& section = sections[(size_t)slot];
+                    auto& z1 = groupState1[slot * numLanes + c];
+                    auto& z2 = groupState2[slot * numLanes + c];
+
+                    auto y = (section.b0 * x) + z1;
+                    z1 = (section.b1 * x) - (section.a1 * y) + z2;
+                    z2 = (section.b2 * x) - (section.a2 * y);
+                    x = y;
+                }
+
+                samples[i] = x;
+            }
+        }
+    }
+
+    std::array<Section, maxSections> sections;
+    //Bit n set when slot n is in use. activeSlots lists those slots in order, so the loops
+    //skip the inactive ones without testing bits per sample.
+    juce::uint32 activeMask{ 0 };
+    std::array<int, maxSections> activeSlots{};
+    int numActiveSections{ 0 };
+
+    //Filter state, laid out [group][slot][lane] so the SIMD path can load a whole section
+    //of a group at once. state2 follows state1 in the same allocation.
+    juce::HeapBlock<char> stateMemory;
+    SampleType* state1{ nullptr };
+    SampleType* state2{ nullptr };
+    size_t stateSize{ 0 };
+
+    juce::HeapBlock<char> interleavedMemory;
+    SampleType* interleaved{ nullptr };
+
+    int numChannels{ 0 }, numGroups{ 0 }, maxBlockSize{ 0 };
+    bool useScalarFallback{ false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BiquadCascade)
+};
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    CoefficientService.cpp
+
+  ==============================================================================
+*/
+
+#include "CoefficientService.h"
+
+CoefficientService::CoefficientService(const ParameterSnapshot& parameterSnapshot)
+    : parameters(parameterSnapshot) {
+}
+
+void CoefficientService::prepare(double sampleRate) {
+    if (table == nullptr || table->getSampleRate() != sampleRate)
+        table = CutCoefficientTable::getShared(sampleRate);
+
+    lowCutFrequency.reset(sampleRate, smoothingSeconds);
+    highCutFrequency.reset(sampleRate, smoothingSeconds);
+
+    //No glide after a prepare, start exactly on the current values
+    auto settings = parameters.getSettings();
+    setTargets(settings);
+    lowCutFrequency.setCurrentAndTargetValue(lowCutFrequency.getTargetValue());
+    highCutFrequency.setCurrentAndTargetValue(highCutFrequency.getTargetValue());
+    lookup();
+}
+
+void CoefficientService::setTargets(const ChainSettings& settings) noexcept {
+    //Multiplicative smoothing can't start from or head to 0, the table's range is the safe one
+    lowCutFrequency.setTargetValue(juce::jlimit(CutCoefficientTable::minFrequency, CutCoefficientTable::maxFrequency, settings.lowCutFreq));
+    highCutFrequency.setTargetValue(juce::jlimit(CutCoefficientTable::minFrequency, CutCoefficientTable::maxFrequency, settings.highCutFreq));
+
+    //The Slope index is 0/1/2 for 12/24/36 dB, which is one less than the number of sections
+    auto lowSections = (int)settings.lowCutSlope + 1;
+    auto highSections = (int)settings.highCutSlope + 1;
+
+    if (lowSections != lowCutSections || highSections != highCutSections) {
+        lowCutSections = lowSections;
+        highCutSections = highSections;
+        needsLookup = true;
+    }
+}
+
+const CutFilterSet& CoefficientService::advance(int numSamples, float octaveOffset) noexcept {
+    lowCutFrequency.skip(numSamples);
+    highCutFrequency.skip(numSamples);
+    lookup(octaveOffset);
+    return current;
+}
+
+void CoefficientService::lookup(float octaveOffset) noexcept {
+    auto scale = octaveOffset != 0.f ? std::exp2(octaveOffset) : 1.f;
+    current.lowCut = table->lookupLowCut(lowCutFrequency.getCurrentValue() * scale, lowCutSections);
+    current.highCut = table->lookupHighCut(highCutFrequency.getCurrentValue() * scale, highCutSections);
+    needsLookup = octaveOffset != 0.f;
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    CoefficientService.h
+
+    Smoothed LowCut/HighCut coefficients, updated every few samples.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CutFilterDesign.h"
+#include "CutCoefficientTable.h"
+#include "ParameterSnapshot.h"
+
+//Everything both CutFilters need for one sub-block
+struct CutFilterSet {
+    CutCoefficients lowCut, highCut;
+};
+
+//Glides the cut frequencies towards their parameter values and turns them into coefficients
+//every subBlockSize samples, so automating LowCut/HighCut sweeps instead of stepping once per
+//host block. The design maths (tan/cos) only runs when the CutCoefficientTable is built for a
+//new sample rate in prepare(). After that an update is a table lookup and a lerp, cheap enough
+//to do on the audio thread at sub-block rate without allocating or locking.
+//
+//Frequencies are smoothed multiplicatively, so a sweep moves at a constant rate in octaves.
+//Slope changes can't be interpolated and switch at the next update.
+class CoefficientService {
+public:
+    //Samples between coefficient updates while a cut frequency is moving
+    static constexpr int subBlockSize = 32;
+
+    explicit CoefficientService(const ParameterSnapshot& parameters);
+
+    //Call from prepareToPlay. Picks up the table for a new sample rate and jumps straight to
+    //the current parameter values, so the first block already has the right filters.
+    void prepare(double sampleRate);
+
+    //Audio thread only from here on.
+
+    //New targets from the cut parameters, call when any of them changed
+    void setTargets(const ChainSettings& settings) noexcept;
+
+    //True while a frequency is gliding or a slope changed, i.e. the filters need updating
+    bool isChanging() const noexcept { return needsLookup || lowCutFrequency.isSmoothing() || highCutFrequency.isSmoothing(); }
+
+    //Moves both frequencies numSamples along and returns the coefficients for where they end up,
+    //shifted by octaveOffset (CutModulator). After a shifted lookup isChanging() stays true until
+    //an unshifted one, so the filters always settle back on the plain frequencies.
+    const CutFilterSet& advance(int numSamples, float octaveOffset = 0.f) noexcept;
+
+    const CutFilterSet& getCurrent() const noexcept { return current; }
+
+private:
+    void lookup(float octaveOffset = 0.f) noexcept;
+
+    const ParameterSnapshot& parameters;
+
+    //Every section for every slope, designed for the current sample rate and shared with every
+    //other instance running at that rate
+    std::shared_ptr<const CutCoefficientTable> table;
+
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> lowCutFrequency, highCutFrequency;
+    int lowCutSections{ 1 }, highCutSections{ 1 };
+    bool needsLookup{ false };
+
+    CutFilterSet current;
+
+    //Roughly how long a jump in a cut frequency takes to glide to its new value
+    static constexpr double smoothingSeconds = 0.05;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CoefficientService)
+};
@@ -0,0 +1,676 @@
+/*
+  ==============================================================================
+
+    ConvolutionReverb.cpp
+
+  ==============================================================================
+*/
+
+#include "ConvolutionReverb.h"
+#include "RealtimeSafety.h"
+
+//==============================================================================
+ConvolutionImpulse::Segment ConvolutionImpulse::makeSegment(const float* samples, int length, int start, int end,
+                                                            int partitionSize, juce::dsp::FFT& fft, std::vector<float>& scratch) {
+    ConvolutionImpulse::Segment segment;
+    segment.partitionSize = partitionSize;
+
+    auto segmentLength = juce::jmax(0, juce::jmin(end, length) - start);
+    segment.numPartitions = (segmentLength + partitionSize - 1) / partitionSize;
+    segment.spectra.resize((size_t)segment.numPartitions * segment.getBinsStride());
+
+    for (int partition = 0; partition < segment.numPartitions; ++partition) {
+        //Each partition is zero padded to twice its length for overlap-save
+        std::fill(scratch.begin(), scratch.end(), 0.f);
+
+        auto offset = start + partition * partitionSize;
+        auto count = juce::jmin(partitionSize, start + segmentLength - offset);
+        std::copy(samples + offset, samples + offset + count, scratch.begin());
+
+        fft.performRealOnlyForwardTransform(scratch.data(), true);
+        std::copy(scratch.begin(), scratch.begin() + (std::ptrdiff_t)segment.getBinsStride(),
+                  segment.spectra.begin() + (std::ptrdiff_t)((size_t)partition * segment.getBinsStride()));
+    }
+
+    return segment;
+}
+
+ConvolutionImpulse::Ptr ConvolutionImpulse::create(const juce::AudioBuffer<float>& impulse, double impulseSampleRate, double sampleRate) {
+    Ptr result = new ConvolutionImpulse();
+    result->sampleRate = sampleRate;
+    result->numChannels = juce::jlimit(1, 2, impulse.getNumChannels());
+
+    auto ratio = impulseSampleRate / sampleRate;
+    auto length = (int)std::ceil(impulse.getNumSamples() / ratio);
+    length = juce::jlimit(1, (int)(maxLengthSeconds * sampleRate), length);
+    result->length = length;
+
+    //Bring it to the processing rate
+    juce::AudioBuffer<float> resampled(result->numChannels, length);
+    for (int c = 0; c < result->numChannels; ++c) {
+        if (ratio == 1.0) {
+            resampled.copyFrom(c, 0, impulse, c, 0, juce::jmin(length, impulse.getNumSamples()));
+        }
+        else {
+            juce::LagrangeInterpolator interpolator;
+            interpolator.process(ratio, impulse.getReadPointer(c), resampled.getWritePointer(c), length, impulse.getNumSamples(), 0);
+        }
+    }
+
+    //Unit energy on the louder channel, so white noise in comes out at about the same level
+    double maxEnergy = 0.0;
+    for (int c = 0; c < result->numChannels; ++c) {
+        double energy = 0.0;
+        auto* samples = resampled.getReadPointer(c);
+        for (int i = 0; i < length; ++i)
+            energy += (double)samples[i] * samples[i];
+        maxEnergy = juce::jmax(maxEnergy, energy);
+    }
+    if (maxEnergy > 0.0)
+        resampled.applyGain((float)(1.0 / std::sqrt(maxEnergy)));
+
+    juce::dsp::FFT bodyFFT(juce::roundToInt(std::log2(2 * bodyPartitionSize)));
+    juce::dsp::FFT tailFFT(juce::roundToInt(std::log2(2 * tailPartitionSize)));
+    std::vector<float> bodyScratch((size_t)bodyPartitionSize * 4), tailScratch((size_t)tailPartitionSize * 4);
+
+    for (int c = 0; c < result->numChannels; ++c) {
+        auto* samples = resampled.getReadPointer(c);
+
+        //Head taps are stored backwards so the direct convolution is a straight dot product
+        std::vector<float> head((size_t)headSize, 0.f);
+        for (int i = 0; i < juce::jmin(headSize, length); ++i)
+            head[(size_t)(headSize - 1 - i)] = samples[i];
+        result->headReversed.push_back(std::move(head));
+
+        result->body.push_back(makeSegment(samples, length, headSize, tailStart, bodyPartitionSize, bodyFFT, bodyScratch));
+        result->tail.push_back(makeSegment(samples, length, tailStart, length, tailPartitionSize, tailFFT, tailScratch));
+    }
+
+    return result;
+}
+
+juce::AudioBuffer<float> ConvolutionImpulse::makeDefaultImpulse(double sampleRate) {
+    //2.5 seconds of noise falling 60dB in 2 seconds, slightly darkened
+    auto length = (int)(2.5 * sampleRate);
+    auto decayPerSample = std::exp(std::log(0.001) / (2.0 * sampleRate));
+
+    juce::AudioBuffer<float> impulse(2, length);
+
+    for (int c = 0; c < 2; ++c) {
+        juce::Random random(0x1234 + c);
+        auto* samples = impulse.getWritePointer(c);
+        double envelope = 1.0;
+        float lowpass = 0.f;
+
+        for (int i = 0; i < length; ++i) {
+            lowpass += 0.4f * ((random.nextFloat() * 2.f - 1.f) - lowpass);
+            samples[i] = lowpass * (float)envelope;
+            envelope *= decayPerSample;
+        }
+    }
+
+    return impulse;
+}
+
+//==============================================================================
+void PartitionConvolver::prepare(int partitionSize, int maxNumPartitions) {
+    size = partitionSize;
+    maxPartitions = juce::jmax(1, maxNumPartitions);
+    binsStride = (size_t)(partitionSize + 1) * 2;
+
+    fft = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2(2 * partitionSize)));
+
+    inputWindow.assign((size_t)size * 2, 0.f);
+    fftBuffer.assign((size_t)size * 4, 0.f);
+    spectrumHistory.assign((size_t)maxPartitions * binsStride, 0.f);
+    accumulator.assign(binsStride, 0.f);
+    historyPosition = 0;
+}
+
+void PartitionConvolver::reset() noexcept {
+    std::fill(inputWindow.begin(), inputWindow.end(), 0.f);
+    std::fill(spectrumHistory.begin(), spectrumHistory.end(), 0.f);
+    historyPosition = 0;
+}
+
+void PartitionConvolver::process(const float* input, float* output, const ConvolutionImpulse::Segment& segment) noexcept {
+    jassert(segment.partitionSize == size);
+
+    if (juce::jmin(segment.numPartitions, maxPartitions) == 0) {
+        std::fill(output, output + size, 0.f);
+        return;
+    }
+
+    pushInput(input);
+    convolve(segment, output);
+}
+
+void PartitionConvolver::pushInput(const float* input) noexcept {
+    //Slide the 2 block window along and transform it
+    std::copy(inputWindow.begin() + size, inputWindow.end(), inputWindow.begin());
+    std::copy(input, input + size, inputWindow.begin() + size);
+
+    std::copy(inputWindow.begin(), inputWindow.end(), fftBuffer.begin());
+    std::fill(fftBuffer.begin() + size * 2, fftBuffer.end(), 0.f);
+    fft->performRealOnlyForwardTransform(fftBuffer.data(), true);
+
+    std::copy(fftBuffer.begin(), fftBuffer.begin() + (std::ptrdiff_t)binsStride,
+              spectrumHistory.begin() + (std::ptrdiff_t)((size_t)historyPosition * binsStride));
+
+    historyPosition = (historyPosition + 1) % maxPartitions;
+}
+
+void PartitionConvolver::convolve(const ConvolutionImpulse::Segment& segment, float* output) noexcept {
+    jassert(segment.partitionSize == size);
+
+    auto numPartitions = juce::jmin(segment.numPartitions, maxPartitions);
+    auto newest = (historyPosition - 1 + maxPartitions) % maxPartitions;
+
+    //Newest input block times the first partition, the one before times the second, and so on
+    std::fill(accumulator.begin(), accumulator.end(), 0.f);
+    auto* sum = accumulator.data();
+
+    for (int partition = 0; partition < numPartitions; ++partition) {
+        auto slot = (newest - partition + maxPartitions) % maxPartitions;
+        auto* x = spectrumHistory.data() + (size_t)slot * binsStride;
+        auto* h = segment.getPartition(partition);
+
+        for (size_t bin = 0; bin < binsStride; bin += 2) {
+            sum[bin] += x[bin] * h[bin] - x[bin + 1] * h[bin + 1];
+            sum[bin + 1] += x[bin] * h[bin + 1] + x[bin + 1] * h[bin];
+        }
+    }
+
+    //Uses the second half of fftBuffer as well, pushInput() only needs it while transforming
+    std::copy(accumulator.begin(), accumulator.end(), fftBuffer.begin());
+    std::fill(fftBuffer.begin() + (std::ptrdiff_t)binsStride, fftBuffer.end(), 0.f);
+    fft->performRealOnlyInverseTransform(fftBuffer.data());
+
+    //Overlap-save: only the second half is free of wrap around
+    std::copy(fftBuffer.begin() + size, fftBuffer.begin() + size * 2, output);
+}
+
+//==============================================================================
+//Builds impulse responses requested from the message thread
+class ConvolutionReverb::Loader : public juce::Thread {
+public:
+    explicit Loader(ConvolutionReverb& reverb) : juce::Thread("WeirdEffects IR Loader"), owner(reverb) {
+        startThread();
+    }
+
+    ~Loader() override {
+        stopThread(4000);
+    }
+
+    void requestBuild() {
+        buildRequested = true;
+        notify();
+    }
+
+    void run() override {
+        while (!threadShouldExit()) {
+            wait(-1);
+
+            if (buildRequested.exchange(false))
+                owner.buildFromSource();
+        }
+    }
+
+private:
+    ConvolutionReverb& owner;
+    std::atomic<bool> buildRequested{ false };
+};
+
+//Worker threads shared by every instance that run their tail blocks, one per core apart from
+//the one the audio thread needs. The audio thread only stores atomics: the first worker polls
+//for them every millisecond, and any worker that picks up an instance wakes an idle one for
+//the rest, so several instances render their tails at the same time. Each instance is only
+//ever run by one worker at a time so its blocks stay in order.
+class ConvolutionReverb::TailWorker {
+public:
+    TailWorker() {
+        auto numThreads = juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+        for (int i = 0; i < numThreads; ++i)
+            threads.add(new WorkerThread(*this, i))->startThread(juce::Thread::Priority::high);
+    }
+
+    ~TailWorker() {
+        //stopThread() wakes a sleeping worker itself
+        for (auto* thread : threads)
+            thread->signalThreadShouldExit();
+        for (auto* thread : threads)
+            thread->stopThread(4000);
+    }
+
+    //Message thread only. Once remove() returns no worker will touch that reverb again.
+    void add(ConvolutionReverb* reverb) {
+        const juce::ScopedWriteLock lock(clientLock);
+        clients.addIfNotAlreadyThere(reverb);
+    }
+
+    void remove(ConvolutionReverb* reverb) {
+        //Waits for any worker still running this reverb's blocks
+        const juce::ScopedWriteLock lock(clientLock);
+        clients.removeFirstMatchingValue(reverb);
+    }
+
+    //Audio thread, after submitting a block. Only an atomic store, the polling worker picks it up.
+    void notify() noexcept { workPending.store(true); }
+
+private:
+    class WorkerThread : public juce::Thread {
+    public:
+        WorkerThread(TailWorker& pool, int workerIndex)
+            : juce::Thread("WeirdEffects Convolution Tail " + juce::String(workerIndex + 1)), owner(pool), index(workerIndex) {}
+
+        void run() override {
+            while (!threadShouldExit()) {
+                //A tail block is due one tail block (tens of milliseconds) after it was submitted,
+                //so polling every millisecond leaves plenty of slack
+                if (index == 0) {
+                    if (!owner.workPending.exchange(false)) {
+                        wait(1);
+                        continue;
+                    }
+                }
+                else {
+                    idle.store(true);
+                    wait(-1);
+                }
+
+                while (!threadShouldExit() && owner.runNextClient()) {}
+            }
+        }
+
+        std::atomic<bool> idle{ false };
+
+    private:
+        TailWorker& owner;
+        const int index;
+    };
+
+    //Runs the blocks of one instance that has some and isn't being run by another worker.
+    //Returns false once there was nothing left to pick up.
+    bool runNextClient() {
+        //Only ever contended by add/remove, never by the audio thread
+        const juce::ScopedReadLock lock(clientLock);
+
+        for (auto* client : clients) {
+            if (!client->hasPendingTailBlocks() || client->tailRunning.exchange(true))
+                continue;
+
+            //Another worker can look after the other instances meanwhile
+            wakeIdleWorker();
+
+            //A block submitted after the last check but before letting go would otherwise wait
+            //for the next submit, the poller may already have skipped this instance as taken
+            do {
+                client->runPendingTailBlocks();
+                client->tailRunning.store(false);
+            } while (client->hasPendingTailBlocks() && !client->tailRunning.exchange(true));
+
+            return true;
+        }
+
+        return false;
+    }
+
+    void wakeIdleWorker() {
+        for (int i = 1; i < threads.size(); ++i) {
+            if (threads[i]->idle.exchange(false)) {
+                threads[i]->notify();
+                return;
+            }
+        }
+    }
+
+    std::atomic<bool> workPending{ false };
+    juce::ReadWriteLock clientLock;
+    juce::Array<ConvolutionReverb*> clients;
+    juce::OwnedArray<WorkerThread> threads;
+};
+
+//==============================================================================
+ConvolutionReverb::ConvolutionReverb() = default;
+
+ConvolutionReverb::~ConvolutionReverb() {
+    release();
+    loader.reset();
+}
+
+void ConvolutionReverb::prepare(const juce::dsp::ProcessSpec& spec) {
+    //Nothing else can be touching the tail jobs after this
+    release();
+
+    //Only started once there is something to load for, a processor keeps one of these per precision
+    if (loader == nullptr)
+        loader = std::make_unique<Loader>(*this);
+
+    numChannels = juce::jmax(1, (int)spec.numChannels);
+
+    {
+        const RealtimeSafety::ScopedLock lock(poolLock);
+        sampleRate = spec.sampleRate;
+
+        if (sourceImpulse.getNumSamples() == 0) {
+            sourceImpulse = ConvolutionImpulse::makeDefaultImpulse(sampleRate);
+            sourceSampleRate = sampleRate;
+        }
+    }
+
+    //Build right here so the first block already has the impulse for this sample rate
+    buildFromSource();
+    current = pendingImpulse.exchange(nullptr);
+    audioImpulse.store(current);
+    workerImpulse.store(nullptr);
+
+    auto bodyPartitions = (ConvolutionImpulse::tailStart - ConvolutionImpulse::headSize) / ConvolutionImpulse::bodyPartitionSize;
+    auto tailPartitions = current != nullptr && !current->tail.empty() ? current->tail[0].numPartitions : 1;
+
+    bodyConvolvers.resize((size_t)numChannels);
+    for (auto& convolver : bodyConvolvers)
+        convolver.prepare(ConvolutionImpulse::bodyPartitionSize, bodyPartitions);
+
+    tailConvolvers.resize((size_t)numChannels);
+    for (auto& convolver : tailConvolvers)
+        convolver.prepare(ConvolutionImpulse::tailPartitionSize, tailPartitions);
+
+    headHistory.setSize(numChannels, 2 * ConvolutionImpulse::headSize);
+    bodyInput.setSize(numChannels, ConvolutionImpulse::bodyPartitionSize);
+    bodyOutput.setSize(numChannels, ConvolutionImpulse::bodyPartitionSize);
+    tailInput.setSize(numChannels, ConvolutionImpulse::tailPartitionSize);
+    tailOutput.setSize(numChannels, ConvolutionImpulse::tailPartitionSize);
+
+    for (auto& job : jobs) {
+        job.input.setSize(numChannels, ConvolutionImpulse::tailPartitionSize);
+        job.output.setSize(numChannels, ConvolutionImpulse::tailPartitionSize);
+        job.impulse.store(nullptr);
+    }
+
+    //Processing never goes further than one body partition before stopping
+    dryGains.malloc((size_t)ConvolutionImpulse::bodyPartitionSize);
+    wetGains.malloc((size_t)ConvolutionImpulse::bodyPartitionSize);
+    dryGain.reset(sampleRate, 0.05);
+    wetGain.reset(sampleRate, 0.05);
+    dryGain.setCurrentAndTargetValue(dryGain.getTargetValue());
+    wetGain.setCurrentAndTargetValue(wetGain.getTargetValue());
+
+    submittedBlocks.store(0);
+    completedBlocks.store(0);
+    nextBlock = 0;
+    reset();
+
+    if (useWorker) {
+        worker->add(this);
+        registeredWithWorker = true;
+    }
+}
+
+void ConvolutionReverb::release() {
+    if (registeredWithWorker) {
+        worker->remove(this);
+        registeredWithWorker = false;
+    }
+}
+
+void ConvolutionReverb::reset() noexcept {
+    headHistory.clear();
+    bodyInput.clear();
+    bodyOutput.clear();
+    tailInput.clear();
+    tailOutput.clear();
+
+    for (auto& convolver : bodyConvolvers)
+        convolver.reset();
+
+    headPosition = 0;
+    bodyPosition = 0;
+    tailPosition = 0;
+
+    //The worker may be mid block, so its history is left alone. Anything still in flight is
+    //simply never collected.
+    hasPendingBlock = false;
+}
+
+void ConvolutionReverb::setMix(float mix) noexcept {
+    mix = juce::jlimit(0.f, 1.f, mix);
+    dryGain.setTargetValue(std::cos(mix * juce::MathConstants<float>::halfPi));
+    wetGain.setTargetValue(std::sin(mix * juce::MathConstants<float>::halfPi));
+}
+
+void ConvolutionReverb::loadImpulseResponse(juce::AudioBuffer<float> impulse, double impulseSampleRate) {
+    {
+        const RealtimeSafety::ScopedLock lock(poolLock);
+        sourceImpulse = std::move(impulse);
+        sourceSampleRate = impulseSampleRate;
+    }
+
+    if (loader != nullptr)
+        loader->requestBuild();
+}
+
+void ConvolutionReverb::buildFromSource() {
+    juce::AudioBuffer<float> source;
+    double rateOfSource, targetRate;
+
+    {
+        const RealtimeSafety::ScopedLock lock(poolLock);
+        if (sourceImpulse.getNumSamples() == 0 || sampleRate <= 0.0)
+            return;
+
+        source.makeCopyOf(sourceImpulse);
+        rateOfSource = sourceSampleRate;
+        targetRate = sampleRate;
+    }
+
+    publish(ConvolutionImpulse::create(source, rateOfSource, targetRate));
+}
+
+void ConvolutionReverb::publish(ConvolutionImpulse::Ptr impulse) {
+    const RealtimeSafety::ScopedLock lock(poolLock);
+
+    //prepare() changed the sample rate while this was being built, it'll build its own
+    if (impulse->sampleRate != sampleRate)
+        return;
+
+    impulse->generation = ++lastGeneration;
+    pool.add(impulse);
+    pendingImpulse.store(impulse.get(), std::memory_order_release);
+    impulseLengthSeconds.store(impulse->length / impulse->sampleRate, std::memory_order_relaxed);
+
+    releaseUnusedImpulses();
+}
+
+void ConvolutionReverb::releaseUnusedImpulses() {
+    //The audio thread only ever moves on to newer impulses, so anything older than the one it
+    //is using can go once neither the worker nor a queued job still points at it
+    auto* inAudio = audioImpulse.load(std::memory_order_acquire);
+    auto audioGeneration = inAudio != nullptr ? inAudio->generation : 0;
+
+    for (int i = pool.size(); --i >= 0;) {
+        auto* impulse = pool.getUnchecked(i);
+
+        if (impulse->generation >= audioGeneration || impulse == workerImpulse.load(std::memory_order_acquire))
+            continue;
+
+        auto inJob = std::any_of(jobs.begin(), jobs.end(), [impulse](const TailJob& job) {
+            return job.impulse.load(std::memory_order_acquire) == impulse;
+        });
+
+        if (!inJob)
+            pool.remove(i);
+    }
+}
+
+template <typename SampleType>
+void ConvolutionReverb::process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept {
+    //Pick up an impulse the loader finished since the last block. It's kept alive by the pool.
+    if (auto* fresh = pendingImpulse.exchange(nullptr, std::memory_order_acq_rel)) {
+        current = fresh;
+        audioImpulse.store(fresh, std::memory_order_release);
+        reset();
+    }
+
+    auto& block = context.getOutputBlock();
+    if (context.isBypassed || current == nullptr) {
+        wasBypassed = true;
+        return;
+    }
+
+    //Whatever was left in the buffers is from before the bypass, don't play it now
+    if (wasBypassed) {
+        reset();
+        wasBypassed = false;
+    }
+
+    auto channels = juce::jmin((int)block.getNumChannels(), numChannels);
+    auto numSamples = (int)block.getNumSamples();
+
+    constexpr auto headSize = ConvolutionImpulse::headSize;
+    constexpr auto bodySize = ConvolutionImpulse::bodyPartitionSize;
+    constexpr auto tailSize = ConvolutionImpulse::tailPartitionSize;
+
+    for (int offset = 0; offset < numSamples;) {
+        //Stop at whichever partition fills up first
+        auto count = juce::jmin(numSamples - offset, bodySize - bodyPosition, tailSize - tailPosition);
+
+        for (int i = 0; i < count; ++i) {
+            dryGains[i] = dryGain.getNextValue();
+            wetGains[i] = wetGain.getNextValue();
+        }
+
+        for (int c = 0; c < channels; ++c) {
+            auto irChannel = (size_t)juce::jmin(c, current->numChannels - 1);
+            auto* taps = current->headReversed[irChannel].data();
+
+            auto* samples = block.getChannelPointer((size_t)c) + offset;
+            auto* history = headHistory.getWritePointer(c);
+            auto* bodyIn = bodyInput.getWritePointer(c) + bodyPosition;
+            auto* bodyOut = bodyOutput.getReadPointer(c) + bodyPosition;
+            auto* tailIn = tailInput.getWritePointer(c) + tailPosition;
+            auto* tailOut = tailOutput.getReadPointer(c) + tailPosition;
+            auto position = headPosition;
+
+            for (int i = 0; i < count; ++i) {
+                auto input = samples[i];
+                auto x = static_cast<float>(input);
+
+                //History is written twice so the last headSize samples are always one contiguous run
+                position = (position + 1) & (headSize - 1);
+                history[position] = x;
+                history[position + headSize] = x;
+
+                auto* window = history + position + 1;
+                float wet = 0.f;
+                for (int k = 0; k < headSize; ++k)
+                    wet += taps[k] * window[k];
+
+                wet += bodyOut[i] + tailOut[i];
+                bodyIn[i] = x;
+                tailIn[i] = x;
+
+                samples[i] = static_cast<SampleType>(dryGains[i]) * input + static_cast<SampleType>(wetGains[i] * wet);
+            }
+        }
+
+        headPosition = (headPosition + count) & (headSize - 1);
+        bodyPosition += count;
+        tailPosition += count;
+        offset += count;
+
+        if (bodyPosition == bodySize) {
+            for (int c = 0; c < channels; ++c) {
+                auto irChannel = (size_t)juce::jmin(c, current->numChannels - 1);
+                bodyConvolvers[(size_t)c].process(bodyInput.getReadPointer(c), bodyOutput.getWritePointer(c), current->body[irChannel]);
+            }
+            bodyPosition = 0;
+        }
+
+        if (tailPosition == tailSize) {
+            onTailBoundary();
+            tailPosition = 0;
+        }
+    }
+}
+
+template void ConvolutionReverb::process<float>(const juce::dsp::ProcessContextReplacing<float>&) noexcept;
+template void ConvolutionReverb::process<double>(const juce::dsp::ProcessContextReplacing<double>&) noexcept;
+
+void ConvolutionReverb::onTailBoundary() noexcept {
+    //Collect the block submitted one tail block ago, it plays for the next tail block
+    if (hasPendingBlock) {
+        if (!useWorker)
+            runPendingTailBlocks();
+
+        if (completedBlocks.load(std::memory_order_acquire) >= nextBlock) {
+            auto& job = jobs[(size_t)((nextBlock - 1) % numJobSlots)];
+            for (int c = 0; c < tailOutput.getNumChannels(); ++c)
+                tailOutput.copyFrom(c, 0, job.output, c, 0, tailOutput.getNumSamples());
+        }
+        else {
+            //Worker didn't make it in time, a gap in the tail is better than waiting
+            tailOutput.clear();
+            lateTailBlocks.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        hasPendingBlock = false;
+    }
+    else {
+        tailOutput.clear();
+    }
+
+    //Submit what was just collected, as long as the worker has finished with that slot
+    if (nextBlock < completedBlocks.load(std::memory_order_acquire) + numJobSlots) {
+        auto& job = jobs[(size_t)(nextBlock % numJobSlots)];
+        for (int c = 0; c < job.input.getNumChannels(); ++c)
+            job.input.copyFrom(c, 0, tailInput, c, 0, tailInput.getNumSamples());
+        job.impulse.store(current, std::memory_order_relaxed);
+
+        ++nextBlock;
+        submittedBlocks.store(nextBlock, std::memory_order_release);
+        hasPendingBlock = true;
+
+        if (useWorker)
+            worker->notify();
+    }
+    else {
+        lateTailBlocks.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void ConvolutionReverb::runPendingTailBlocks() {
+    auto completed = completedBlocks.load(std::memory_order_relaxed);
+    auto submitted = submittedBlocks.load(std::memory_order_acquire);
+
+    while (completed < submitted) {
+        auto& job = jobs[(size_t)(completed % numJobSlots)];
+        auto* impulse = job.impulse.load(std::memory_order_relaxed);
+
+        //New impulse: start the tail history again, growing it if this one is longer.
+        //This allocates, which is fine on the worker (and offline when it runs inline).
+        if (impulse != workerImpulse.load(std::memory_order_relaxed)) {
+            workerImpulse.store(impulse, std::memory_order_release);
+
+            for (auto& convolver : tailConvolvers) {
+                auto needed = impulse != nullptr && !impulse->tail.empty() ? impulse->tail[0].numPartitions : 0;
+                if (needed > convolver.getMaxPartitions())
+                    convolver.prepare(ConvolutionImpulse::tailPartitionSize, needed);
+                else
+                    convolver.reset();
+            }
+        }
+
+        for (int c = 0; c < job.output.getNumChannels(); ++c) {
+            if (impulse != nullptr && c < (int)tailConvolvers.size()) {
+                auto irChannel = (size_t)juce::jmin(c, impulse->numChannels - 1);
+                tailConvolvers[(size_t)c].process(job.input.getReadPointer(c), job.output.getWritePointer(c), impulse->tail[irChannel]);
+            }
+            else {
+                job.output.clear(c, 0, job.output.getNumSamples());
+            }
+        }
+
+        ++completed;
+        completedBlocks.store(completed, std::memory_order_release);
+    }
+}
@@ -0,0 +1,205 @@
+/*
+  ==============================================================================
+
+    ConvolutionReverb.h
+
+    Zero latency, non-uniformly partitioned convolution reverb.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//An impulse response cut into three segments, with every FFT already done for one sample rate:
+//
+//  head  [0, headSize)             time domain taps, convolved directly (no latency at all)
+//  body  [headSize, tailStart)     small FFT partitions, run in processBlock
+//  tail  [tailStart, end)          big FFT partitions, run on a background thread
+//
+//Each segment starts exactly as late as its own processing delay, so together they add up to
+//the full convolution with zero added latency. Built off the audio thread and never modified
+//after, so it can be shared between the audio thread and the tail worker without locking.
+class ConvolutionImpulse : public juce::ReferenceCountedObject {
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<ConvolutionImpulse>;
+
+    static constexpr int headSize = 128;
+    static constexpr int bodyPartitionSize = 128;
+    static constexpr int tailPartitionSize = 2048;
+    //Tail results arrive one tail block after they're submitted, so the tail starts two blocks in
+    static constexpr int tailStart = 2 * tailPartitionSize;
+    static constexpr double maxLengthSeconds = 12.0;
+
+    //Partitions of one segment for one channel, each stored as partitionSize + 1 complex bins
+    struct Segment {
+        int partitionSize{ 0 }, numPartitions{ 0 };
+        std::vector<float> spectra;
+
+        size_t getBinsStride() const noexcept { return (size_t)(partitionSize + 1) * 2; }
+        const float* getPartition(int index) const noexcept { return spectra.data() + (size_t)index * getBinsStride(); }
+    };
+
+    //Resamples to sampleRate, normalises and partitions. Slow, never call on the audio thread.
+    static Ptr create(const juce::AudioBuffer<float>& impulse, double impulseSampleRate, double sampleRate);
+
+    //Partitions samples [start, end) into FFTs of 2 * partitionSize. fft must be that size and
+    //scratch at least twice that long.
+    static Segment makeSegment(const float* samples, int length, int start, int end,
+                               int partitionSize, juce::dsp::FFT& fft, std::vector<float>& scratch);
+
+    //Exponentially decaying stereo noise, used until an impulse response file is loaded
+    static juce::AudioBuffer<float> makeDefaultImpulse(double sampleRate);
+
+    int numChannels{ 0 }, length{ 0 };
+    double sampleRate{ 0 };
+    //Order of publication, newer impulses have bigger numbers
+    juce::uint64 generation{ 0 };
+
+    std::vector<std::vector<float>> headReversed;
+    std::vector<Segment> body, tail;
+};
+
+//Overlap-save convolution of one segment for one channel, partitionSize samples at a time.
+//Keeps a frequency domain delay line of past input blocks, so each block costs one forward FFT,
+//one complex multiply-add per partition and one inverse FFT.
+class PartitionConvolver {
+public:
+    //Allocates, keep it off the audio thread
+    void prepare(int partitionSize, int maxPartitions);
+    void reset() noexcept;
+
+    int getMaxPartitions() const noexcept { return maxPartitions; }
+
+    //Convolves exactly partitionSize new input samples, writing partitionSize output samples
+    void process(const float* input, float* output, const ConvolutionImpulse::Segment& segment) noexcept;
+
+    //process() in two steps. The input history doesn't depend on the segment, so one pushInput()
+    //can be followed by convolve() with several segments, e.g. to crossfade between two of them.
+    void pushInput(const float* input) noexcept;
+    void convolve(const ConvolutionImpulse::Segment& segment, float* output) noexcept;
+
+private:
+    std::unique_ptr<juce::dsp::FFT> fft;
+    int size{ 0 }, maxPartitions{ 0 }, historyPosition{ 0 };
+    size_t binsStride{ 0 };
+
+    std::vector<float> inputWindow, fftBuffer, spectrumHistory, accumulator;
+};
+
+//Second reverb mode next to FDNReverb. The head and body run inside process(), tail blocks are
+//handed to a pool of background workers shared by every instance through a ring of job slots
+//and two atomic counters. Submitting a block only stores atomics for a polling worker to see,
+//so the audio thread never waits or locks.
+//
+//In offline rendering (setUseBackgroundTail(false)) the tail runs inline instead, which gives
+//exactly the same output without depending on how fast the workers happen to be.
+//
+//Has prepare/reset/process so it can sit in a juce::dsp::ProcessorChain of either precision.
+class ConvolutionReverb {
+public:
+    ConvolutionReverb();
+    ~ConvolutionReverb();
+
+    //Builds the partitions for the new sample rate straight away and allocates every buffer
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+    void release();
+
+    //float or double. The partitions are always float (that's what juce::dsp::FFT does), but
+    //the dry signal and the mix stay in the block's own precision.
+    template <typename SampleType>
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept;
+
+    //0 = dry only, 1 = reverb only, equal power in between
+    void setMix(float mix) noexcept;
+
+    //Mix at 0 and done gliding there, so process() would hand the input back unchanged
+    bool isFullyDry() const noexcept { return wetGain.getTargetValue() == 0.f && !wetGain.isSmoothing(); }
+
+    //Call before prepare(). Realtime playback should use the worker, offline renders shouldn't.
+    void setUseBackgroundTail(bool shouldUseWorker) noexcept { useWorker = shouldUseWorker; }
+
+    //Message thread. The partitions are built on a background thread and swapped in when ready,
+    //or in the next prepare() if this hasn't been prepared yet.
+    void loadImpulseResponse(juce::AudioBuffer<float> impulse, double impulseSampleRate);
+
+    //Length of the most recently loaded impulse response, for the processor's tail length. Any thread.
+    double getImpulseLengthSeconds() const noexcept { return impulseLengthSeconds.load(std::memory_order_relaxed); }
+
+    //Tail blocks that weren't back from the worker in time and were played as silence
+    juce::uint64 getLateTailBlocks() const noexcept { return lateTailBlocks.load(std::memory_order_relaxed); }
+
+private:
+    class Loader;
+    class TailWorker;
+    friend class TailWorker;
+
+    //Runs every tail block submitted so far. Called by a worker, or inline when they aren't used.
+    void runPendingTailBlocks();
+    bool hasPendingTailBlocks() const noexcept {
+        return completedBlocks.load(std::memory_order_relaxed) < submittedBlocks.load();
+    }
+
+    //Called every tailPartitionSize samples on the audio thread
+    void onTailBoundary() noexcept;
+
+    //Builds from sourceImpulse at the current sample rate and publishes the result
+    void buildFromSource();
+
+    //Puts a freshly built impulse where the audio thread will pick it up, and frees old ones
+    void publish(ConvolutionImpulse::Ptr impulse);
+    void releaseUnusedImpulses();
+
+    //Blocks that can be in flight at once. More than one, so a worker that gets held up for a
+    //block or two, with several instances sharing the pool, doesn't leave gaps in the tail.
+    static constexpr int numJobSlots = 8;
+
+    struct TailJob {
+        juce::AudioBuffer<float> input, output;
+        std::atomic<ConvolutionImpulse*> impulse{ nullptr };
+    };
+
+    //Everything built so far. Only the message/loader threads add or remove, under poolLock,
+    //so the audio thread and worker can use plain pointers without ever freeing anything.
+    juce::CriticalSection poolLock;
+    juce::ReferenceCountedArray<ConvolutionImpulse> pool;
+    juce::AudioBuffer<float> sourceImpulse;
+    double sourceSampleRate{ 0 };
+    juce::uint64 lastGeneration{ 0 };
+
+    std::atomic<ConvolutionImpulse*> pendingImpulse{ nullptr };
+    std::atomic<ConvolutionImpulse*> audioImpulse{ nullptr };
+    std::atomic<ConvolutionImpulse*> workerImpulse{ nullptr };
+
+    //Audio thread state
+    ConvolutionImpulse* current{ nullptr };
+    std::vector<PartitionConvolver> bodyConvolvers;
+    juce::AudioBuffer<float> headHistory, bodyInput, bodyOutput, tailInput, tailOutput;
+    juce::HeapBlock<float> dryGains, wetGains;
+    int headPosition{ 0 }, bodyPosition{ 0 }, tailPosition{ 0 };
+    juce::uint64 nextBlock{ 0 };
+    bool hasPendingBlock{ false }, wasBypassed{ false };
+    juce::SmoothedValue<float> dryGain, wetGain;
+
+    //Tail worker state, only touched by whoever runs runPendingTailBlocks()
+    std::vector<PartitionConvolver> tailConvolvers;
+
+    std::array<TailJob, numJobSlots> jobs;
+    std::atomic<juce::uint64> submittedBlocks{ 0 }, completedBlocks{ 0 };
+    //Set by the worker running this instance's blocks, so no other picks them up. Sequentially
+    //consistent along with the submittedBlocks check, see TailWorker::runNextClient().
+    std::atomic<bool> tailRunning{ false };
+    std::atomic<juce::uint64> lateTailBlocks{ 0 };
+    std::atomic<double> impulseLengthSeconds{ 0 };
+
+    double sampleRate{ 0 };
+    int numChannels{ 0 };
+    bool useWorker{ true }, registeredWithWorker{ false };
+
+    std::unique_ptr<Loader> loader;
+    juce::SharedResourcePointer<TailWorker> worker;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConvolutionReverb)
+};
@@ -0,0 +1,109 @@
+/*
+  ==============================================================================
+
+    CutCoefficientTable.cpp
+
+  ==============================================================================
+*/
+
+#include "CutCoefficientTable.h"
+#include "RealtimeSafety.h"
+
+void CutCoefficientTable::prepare(double sampleRate) {
+    //Only the sample rate changes the designs, so there's nothing to do if it's the same
+    if (isReady() && sampleRate == currentSampleRate)
+        return;
+
+    //Extra cache line so the start can be snapped to a 64 byte boundary
+    memory.calloc((size_t)(numArrays * arrayStride + valuesPerCacheLine));
+    data = juce::snapPointerToAlignment(memory.getData(), 64);
+
+    currentSampleRate = sampleRate;
+    logMinFrequency = std::log((double)minFrequency);
+    pointsPerLogUnit = (double)(numPoints - 1) / (std::log((double)maxFrequency) - logMinFrequency);
+
+    for (int point = 0; point < numPoints; ++point) {
+        auto frequency = (float)std::exp(logMinFrequency + (double)point / pointsPerLogUnit);
+
+        for (int numSections = 1; numSections <= CutCoefficients::maxSections; ++numSections) {
+            auto lowCut = CutFilterDesign::makeLowCut(frequency, sampleRate, numSections);
+            auto highCut = CutFilterDesign::makeHighCut(frequency, sampleRate, numSections);
+
+            for (int section = 0; section < numSections; ++section) {
+                auto& low = lowCut.sections[(size_t)section];
+                getArray(lowCutType, numSections, section, b0Parameter)[point] = low.b0;
+                getArray(lowCutType, numSections, section, a1Parameter)[point] = low.a1;
+                getArray(lowCutType, numSections, section, a2Parameter)[point] = low.a2;
+
+                auto& high = highCut.sections[(size_t)section];
+                getArray(highCutType, numSections, section, b0Parameter)[point] = high.b0;
+                getArray(highCutType, numSections, section, a1Parameter)[point] = high.a1;
+                getArray(highCutType, numSections, section, a2Parameter)[point] = high.a2;
+            }
+        }
+    }
+}
+
+std::shared_ptr<const CutCoefficientTable> CutCoefficientTable::getShared(double sampleRate) {
+    static juce::CriticalSection cacheLock;
+    static std::vector<std::weak_ptr<const CutCoefficientTable>> cache;
+
+    const RealtimeSafety::ScopedLock lock(cacheLock);
+
+    //Tables nobody holds any more have already been freed, drop their entries on the way
+    std::shared_ptr<const CutCoefficientTable> result;
+    cache.erase(std::remove_if(cache.begin(), cache.end(), [&](const auto& entry) {
+        auto table = entry.lock();
+        if (table != nullptr && table->getSampleRate() == sampleRate)
+            result = table;
+        return table == nullptr;
+    }), cache.end());
+
+    if (result == nullptr) {
+        auto table = std::make_shared<CutCoefficientTable>();
+        table->prepare(sampleRate);
+        cache.push_back(table);
+        result = std::move(table);
+    }
+
+    return result;
+}
+
+CutCoefficients CutCoefficientTable::lookupLowCut(float frequency, int numSections) const noexcept {
+    return lookup(lowCutType, frequency, numSections);
+}
+
+CutCoefficients CutCoefficientTable::lookupHighCut(float frequency, int numSections) const noexcept {
+    return lookup(highCutType, frequency, numSections);
+}
+
+CutCoefficients CutCoefficientTable::lookup(CutType type, float frequency, int numSections) const noexcept {
+    jassert(isReady());
+    jassert(numSections > 0 && numSections <= CutCoefficients::maxSections);
+
+    //Position on the log grid, split into the point below and how far towards the next one
+    auto position = (std::log((double)juce::jlimit(minFrequency, maxFrequency, frequency)) - logMinFrequency) * pointsPerLogUnit;
+    auto index = juce::jlimit(0, numPoints - 2, (int)position);
+    auto fraction = juce::jlimit(0.0, 1.0, position - (double)index);
+
+    auto lerp = [index, fraction](const double* values) {
+        return values[index] + fraction * (values[index + 1] - values[index]);
+    };
+
+    //b1 is -2 * b0 for the high pass (LowCut) and +2 * b0 for the low pass (HighCut)
+    auto b1Scale = type == lowCutType ? -2.0 : 2.0;
+
+    CutCoefficients result;
+    result.numSections = numSections;
+
+    for (int section = 0; section < numSections; ++section) {
+        auto& coefficients = result.sections[(size_t)section];
+        coefficients.b0 = lerp(getArray(type, numSections, section, b0Parameter));
+        coefficients.b1 = b1Scale * coefficients.b0;
+        coefficients.b2 = coefficients.b0;
+        coefficients.a1 = lerp(getArray(type, numSections, section, a1Parameter));
+        coefficients.a2 = lerp(getArray(type, numSections, section, a2Parameter));
+    }
+
+    return result;
+}
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    CutCoefficientTable.h
+
+    Pre-designed Butterworth sections on a log frequency grid.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CutFilterDesign.h"
+
+//Holds every LowCut/HighCut section for 12, 24 and 36 dB/Oct at numPoints frequencies
+//between 20Hz and 20kHz, designed once per sample rate. Moving a cut frequency then costs a
+//table lookup and a lerp instead of a full tan()/cos() redesign.
+//
+//A Butterworth high pass section is c1 * (1, -2, 1) over (1, a1, a2) and a low pass is
+//c1 * (1, 2, 1) over (1, a1, a2), so only b0 (= c1), a1 and a2 are stored and b1/b2 are
+//rebuilt from b0. That keeps the zeros exactly at DC/nyquist after interpolating, and since
+//the stable (a1, a2) region is a triangle, lerping between two stable sections stays stable.
+//
+//Each of those parameters is its own contiguous array (structure of arrays) starting on a
+//64 byte boundary, so a sweep only walks through neighbouring cache lines. Values are double
+//so the double precision chain doesn't lose anything to the table.
+class CutCoefficientTable {
+public:
+    static constexpr int numPoints = 512;
+    static constexpr float minFrequency = 20.f;
+    static constexpr float maxFrequency = 20000.f;
+
+    CutCoefficientTable() = default;
+
+    //Rebuilds the table if the sample rate changed, otherwise does nothing.
+    //Allocates and designs every point, so keep this to prepareToPlay.
+    void prepare(double sampleRate);
+
+    //One table per sample rate for every instance in the process, built by whichever instance
+    //asks first and freed with the last one using it. A session with hundreds of instances at
+    //the same rate designs the table once instead of once per instance. Locks, so prepareToPlay only.
+    static std::shared_ptr<const CutCoefficientTable> getShared(double sampleRate);
+
+    bool isReady() const noexcept { return data != nullptr; }
+    double getSampleRate() const noexcept { return currentSampleRate; }
+
+    //No trig and no allocation, safe on any thread once prepare() has finished
+    CutCoefficients lookupLowCut(float frequency, int numSections) const noexcept;
+    CutCoefficients lookupHighCut(float frequency, int numSections) const noexcept;
+
+private:
+    enum CutType {
+        lowCutType,
+        highCutType,
+        numCutTypes,
+    };
+
+    enum SectionParameter {
+        b0Parameter,
+        a1Parameter,
+        a2Parameter,
+        numSectionParameters,
+    };
+
+    //1 + 2 + 3 sections for the three slopes
+    static constexpr int sectionsPerType = 6;
+    static constexpr int numArrays = numCutTypes * sectionsPerType * numSectionParameters;
+
+    //Each array is padded to a whole number of cache lines
+    static constexpr int valuesPerCacheLine = 64 / (int)sizeof(double);
+    static constexpr int arrayStride = ((numPoints + valuesPerCacheLine - 1) / valuesPerCacheLine) * valuesPerCacheLine;
+
+    //Sections for slope n start after the 1 + ... + (n - 1) sections of the shallower slopes
+    static int getFirstSection(int numSections) noexcept { return (numSections - 1) * numSections / 2; }
+
+    double* getArray(CutType type, int numSections, int section, SectionParameter parameter) const noexcept {
+        auto index = ((int)type * sectionsPerType + getFirstSection(numSections) + section) * numSectionParameters + (int)parameter;
+        return data + index * arrayStride;
+    }
+
+    CutCoefficients lookup(CutType type, float frequency, int numSections) const noexcept;
+
+    juce::HeapBlock<double> memory;
+    double* data{ nullptr };
+
+    double currentSampleRate{ 0.0 };
+    double logMinFrequency{ 0.0 }, pointsPerLogUnit{ 0.0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CutCoefficientTable)
+};
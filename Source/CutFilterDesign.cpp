@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    CutFilterDesign.cpp
+
+  ==============================================================================
+*/
+
+#include "CutFilterDesign.h"
+
+namespace CutFilterDesign {
+
+    //Keeps the cutoff inside (0, nyquist) so tan() never blows up at low sample rates
+    static double clampFrequency(float frequency, double sampleRate) {
+        return juce::jlimit(1.0, sampleRate * 0.49, static_cast<double>(frequency));
+    }
+
+    double getButterworthQ(int index, int numSections) {
+        //Same formula as designIIRHighpassHighOrderButterworthMethod with order = 2 * numSections
+        auto order = 2.0 * numSections;
+        return 1.0 / (2.0 * std::cos((2.0 * index + 1.0) * juce::MathConstants<double>::pi / (order * 2.0)));
+    }
+
+    CutCoefficients makeLowCut(float frequency, double sampleRate, int numSections) {
+        jassert(numSections > 0 && numSections <= CutCoefficients::maxSections);
+
+        CutCoefficients result;
+        result.numSections = numSections;
+
+        //Matches IIR::Coefficients::makeHighPass, written out so nothing gets allocated
+        auto n = std::tan(juce::MathConstants<double>::pi * clampFrequency(frequency, sampleRate) / sampleRate);
+        auto nSquared = n * n;
+
+        for (int i = 0; i < numSections; ++i) {
+            auto invQ = 1.0 / getButterworthQ(i, numSections);
+            auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+            auto& section = result.sections[(size_t)i];
+            section.b0 = c1;
+            section.b1 = c1 * -2.0;
+            section.b2 = c1;
+            section.a1 = c1 * 2.0 * (nSquared - 1.0);
+            section.a2 = c1 * (1.0 - invQ * n + nSquared);
+        }
+
+        return result;
+    }
+
+    CutCoefficients makeHighCut(float frequency, double sampleRate, int numSections) {
+        jassert(numSections > 0 && numSections <= CutCoefficients::maxSections);
+
+        CutCoefficients result;
+        result.numSections = numSections;
+
+        //Matches IIR::Coefficients::makeLowPass
+        auto n = 1.0 / std::tan(juce::MathConstants<double>::pi * clampFrequency(frequency, sampleRate) / sampleRate);
+        auto nSquared = n * n;
+
+        for (int i = 0; i < numSections; ++i) {
+            auto invQ = 1.0 / getButterworthQ(i, numSections);
+            auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+            auto& section = result.sections[(size_t)i];
+            section.b0 = c1;
+            section.b1 = c1 * 2.0;
+            section.b2 = c1;
+            section.a1 = c1 * 2.0 * (1.0 - nSquared);
+            section.a2 = c1 * (1.0 - invQ * n + nSquared);
+        }
+
+        return result;
+    }
+}
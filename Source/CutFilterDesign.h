@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    CutFilterDesign.h
+
+    Plain-data Butterworth designs for the LowCut/HighCut stages.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//One biquad section, normalised so a0 == 1. This is the same order JUCE keeps
+//inside IIR::Coefficients (b0, b1, b2, a1, a2), but as plain data so it can be
+//handed between threads and copied into a filter without allocating.
+//
+//Kept in double so the double precision chain gets the full design. At 192kHz a 20Hz
+//36dB/Oct cut has poles within 1e-3 of the unit circle, where float rounding shows.
+struct BiquadCoefficients {
+    double b0{ 1 }, b1{ 0 }, b2{ 0 }, a1{ 0 }, a2{ 0 };
+};
+
+//Every section a single CutFilter needs. 12dB/Oct uses 1 section, 24dB/Oct 2 and 36dB/Oct 3.
+struct CutCoefficients {
+    static constexpr int maxSections = 3;
+
+    std::array<BiquadCoefficients, maxSections> sections;
+    int numSections{ 1 };
+};
+
+namespace CutFilterDesign {
+
+    //Same maths as FilterDesign::designIIRHighpassHighOrderButterworthMethod, but it writes
+    //into a plain struct instead of allocating an array of Coefficients::Ptr.
+    //numSections is order / 2, so Slope_12dB -> 1, Slope_24dB -> 2, Slope_36dB -> 3
+    CutCoefficients makeLowCut(float frequency, double sampleRate, int numSections);
+    CutCoefficients makeHighCut(float frequency, double sampleRate, int numSections);
+
+    //Butterworth Q of section `index` in a cascade of `numSections` biquads
+    double getButterworthQ(int index, int numSections);
+}
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    CutFilterResponse.cpp
+
+  ==============================================================================
+*/
+
+#include "CutFilterResponse.h"
+
+void CutFilterResponse::prepare(const float* frequencies, int numFrequenciesToUse, double sampleRate) {
+    numFrequencies = numFrequenciesToUse;
+
+    for (auto* array : { &phi, &phiSquared, &numerator, &denominator, &scratch })
+        array->resize((size_t)numFrequencies);
+
+    for (size_t i = 0; i < (size_t)numFrequencies; ++i) {
+        //Past nyquist the response just mirrors, so stop there
+        auto frequency = juce::jmin((double)frequencies[i], sampleRate * 0.5);
+        auto s = std::sin(juce::MathConstants<double>::pi * frequency / sampleRate);
+        phi[i] = s * s;
+        phiSquared[i] = phi[i] * phi[i];
+    }
+}
+
+void CutFilterResponse::process(const CutCoefficients& lowCut, const CutCoefficients& highCut, float gainDecibels, float* decibels) noexcept {
+    std::fill(numerator.begin(), numerator.end(), 1.0);
+    std::fill(denominator.begin(), denominator.end(), 1.0);
+
+    for (auto* cut : { &lowCut, &highCut }) {
+        for (int s = 0; s < cut->numSections; ++s) {
+            auto& c = cut->sections[(size_t)s];
+
+            auto sumB = c.b0 + c.b1 + c.b2;
+            multiplyPolynomial(numerator, sumB * sumB, -4.0 * (c.b0 * c.b1 + 4.0 * c.b0 * c.b2 + c.b1 * c.b2), 16.0 * c.b0 * c.b2);
+
+            auto sumA = 1.0 + c.a1 + c.a2;
+            multiplyPolynomial(denominator, sumA * sumA, -4.0 * (c.a1 + 4.0 * c.a2 + c.a1 * c.a2), 16.0 * c.a2);
+        }
+    }
+
+    //Squared magnitude, hence 10 * log10
+    for (size_t i = 0; i < (size_t)numFrequencies; ++i) {
+        auto power = numerator[i] / juce::jmax(denominator[i], 1.0e-300);
+        decibels[i] = power > 0.0 ? juce::jmax(floorDecibels, (float)(10.0 * std::log10(power)) + gainDecibels) : floorDecibels;
+    }
+}
+
+void CutFilterResponse::multiplyPolynomial(std::vector<double>& product, double k0, double k1, double k2) noexcept {
+    //scratch = k0 + k1 * phi + k2 * phi^2, then product *= scratch
+    juce::FloatVectorOperations::multiply(scratch.data(), phi.data(), k1, numFrequencies);
+    juce::FloatVectorOperations::addWithMultiply(scratch.data(), phiSquared.data(), k2, numFrequencies);
+    juce::FloatVectorOperations::add(scratch.data(), k0, numFrequencies);
+    juce::FloatVectorOperations::multiply(product.data(), scratch.data(), numFrequencies);
+}
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    CutModulator.h
+
+    LFO + envelope follower moving the cut frequencies.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Works out, for every sample of a block, how many octaves to move both cut frequencies by:
+//a sine LFO times "Mod Depth" plus the input's envelope times "Mod Envelope". The state
+//variable cuts follow it every sample, the Butterworth cuts once per CoefficientService
+//sub-block.
+class CutModulator {
+public:
+    CutModulator() = default;
+
+    //Allocates the offset buffer, so never call this from processBlock
+    void prepare(double newSampleRate, int maxBlockSize) {
+        sampleRate = newSampleRate;
+        offsets.calloc((size_t)maxBlockSize);
+        maxSamples = maxBlockSize;
+
+        //Fast enough to follow drum hits, slow enough not to ring with the waveform
+        attack = (float)std::exp(-1.0 / (0.005 * sampleRate));
+        release = (float)std::exp(-1.0 / (0.15 * sampleRate));
+
+        setParameters(rate, depth, envelopeAmount);
+        reset();
+    }
+
+    void reset() noexcept {
+        phase = 0.f;
+        envelope = 0.f;
+    }
+
+    void setParameters(float rateHz, float depthOctaves, float envelopeOctaves) noexcept {
+        rate = rateHz;
+        depth = depthOctaves;
+        envelopeAmount = envelopeOctaves;
+        phaseIncrement = (float)(juce::MathConstants<double>::twoPi * rate / sampleRate);
+    }
+
+    //Nothing to move, the cuts can run with their plain frequencies
+    bool isActive() const noexcept { return depth != 0.f || envelopeAmount != 0.f; }
+
+    //Fills getOffsets() with block.getNumSamples() values
+    template <typename SampleType>
+    void process(const juce::dsp::AudioBlock<SampleType>& block) noexcept {
+        auto numSamples = (int)block.getNumSamples();
+        jassert(numSamples <= maxSamples);
+
+        auto* output = offsets.get();
+
+        //Peak over all channels first, channel by channel so each pass vectorises
+        std::fill(output, output + numSamples, 0.f);
+        if (envelopeAmount != 0.f) {
+            for (size_t c = 0; c < block.getNumChannels(); ++c) {
+                auto* samples = block.getChannelPointer(c);
+                for (int i = 0; i < numSamples; ++i)
+                    output[i] = juce::jmax(output[i], (float)std::abs(samples[i]));
+            }
+        }
+
+        for (int i = 0; i < numSamples; ++i) {
+            auto level = output[i];
+            envelope = level + (level > envelope ? attack : release) * (envelope - level);
+
+            //FastMathApproximations::sin is accurate over -pi..pi, so the phase stays there
+            output[i] = depth * juce::dsp::FastMathApproximations::sin(phase) + envelopeAmount * envelope;
+
+            phase += phaseIncrement;
+            if (phase >= juce::MathConstants<float>::pi)
+                phase -= juce::MathConstants<float>::twoPi;
+        }
+    }
+
+    const float* getOffsets() const noexcept { return offsets.get(); }
+
+private:
+    double sampleRate{ 44100.0 };
+    float rate{ 1.f }, depth{ 0 }, envelopeAmount{ 0 };
+    float phase{ 0 }, phaseIncrement{ 0 };
+    float envelope{ 0 }, attack{ 0 }, release{ 0 };
+
+    juce::HeapBlock<float> offsets;
+    int maxSamples{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CutModulator)
+};
@@ -0,0 +1,427 @@
+/*
+  ==============================================================================
+
+    FDNReverb.h
+
+    8 line feedback delay network reverb.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Replacement for juce::dsp::Reverb. Freeverb runs 8 combs and 4 allpasses per channel
+//(24 delay lines for stereo), this runs 8 delay lines shared by both channels:
+//
+//  - every line is read with a slowly modulated fractional delay, which smears the
+//    resonances and stops metallic ringing
+//  - each line goes through a one pole lowpass (damping) and its decay gain
+//  - the lines are mixed with a Householder matrix (x - 2/N * sum(x)), which is lossless
+//    and costs one sum instead of a full N*N multiply
+//  - the left input feeds lines 0-3, the right input 4-7, and each output taps all lines
+//    with a different sign pattern so the two sides stay decorrelated
+//  - wider layouts share the same 8 lines: even channels are summed into the left input, odd
+//    ones into the right, and every channel gets its own output sign pattern, so a 7.1.4 bus
+//    costs 12 dot products per sample on top of the stereo tank instead of 6 reverbs
+//
+//All the per-line maths runs on juce::dsp::SIMDRegister vectors across the lines. The delay
+//lines themselves live in one contiguous block, each a power of two long so wrapping is a mask.
+//That block only exists while it's wanted (setMemoryWanted), an instance that never uses the
+//reverb doesn't hold on to it.
+//
+//Has prepare/reset/process so it can sit in a juce::dsp::ProcessorChain.
+template <typename SampleType>
+class FDNReverb {
+public:
+    static constexpr int numLines = 8;
+
+    struct Parameters {
+        //0-1, scales every delay line between a small room and the full lengths
+        float size{ 0.5f };
+        //Time for the tail to fall by 60dB
+        float decaySeconds{ 1.5f };
+        //0 = dry only, 1 = reverb only, equal power in between
+        float mix{ 0.f };
+    };
+
+    //Maps the 0-100 "Reverb" parameter onto size, decay and mix together
+    static Parameters parametersFromAmount(float amount) noexcept {
+        auto normalised = juce::jlimit(0.f, 1.f, amount / 100.f);
+
+        Parameters parameters;
+        parameters.size = 0.3f + 0.7f * normalised;
+        parameters.decaySeconds = 0.4f + 5.6f * normalised * normalised;
+        parameters.mix = normalised;
+        return parameters;
+    }
+
+    FDNReverb() = default;
+
+    //Allocates the delay memory for the largest size, unless setMemoryWanted(false) said it's
+    //not needed, so never call this from processBlock
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        sampleRate = spec.sampleRate;
+        numChannels = (int)spec.numChannels;
+
+        //Keeps the level into the tank about the same however many channels get summed
+        inputScale = static_cast<SampleType>(1.0 / std::sqrt((double)juce::jmax(1, (numChannels + 1) / 2)));
+
+        //Output taps of every channel, [channel][line]. 0 and 1 are the stereo patterns, the rest
+        //are rows of an 8x8 Hadamard matrix (rotated once they run out) so they stay decorrelated.
+        outputSignsMemory.calloc((size_t)(juce::jmax(2, numChannels) * numLines) * sizeof(SampleType) + 64);
+        outputSigns = reinterpret_cast<SampleType*>(juce::snapPointerToAlignment(outputSignsMemory.getData(), (size_t)64));
+
+        for (int c = 0; c < juce::jmax(2, numChannels); ++c) {
+            auto* signs = outputSigns + c * numLines;
+
+            for (int i = 0; i < numLines; ++i) {
+                if (c < 2) {
+                    signs[i] = (c == 0 ? leftOutputSigns : rightOutputSigns)[(size_t)i];
+                }
+                else {
+                    auto row = 1 + (c - 2) % (numLines - 1);
+                    auto column = (i + (c - 2) / (numLines - 1)) % numLines;
+                    signs[i] = juce::countNumberOfBits((juce::uint32)(row & column)) % 2 == 0 ? SampleType(1) : SampleType(-1);
+                }
+            }
+        }
+
+        channelPointers.calloc((size_t)juce::jmax(1, numChannels));
+
+        auto modulationDepth = modulationDepthSeconds * sampleRate;
+        size_t totalLength = 0;
+
+        for (size_t i = 0; i < (size_t)numLines; ++i) {
+            baseDelays[i] = static_cast<SampleType>(baseDelaySeconds[i] * sampleRate);
+
+            //Longest possible read is full size plus the modulation swing, with room to interpolate
+            auto longest = (int)std::ceil(baseDelaySeconds[i] * sampleRate + 2.0 * modulationDepth) + 4;
+            lineLengths[i] = juce::nextPowerOfTwo(longest);
+            lineOffsets[i] = totalLength;
+            totalLength += (size_t)lineLengths[i];
+        }
+
+        //One allocation for every line. Nothing else can be holding the old one while preparing.
+        totalMemoryLength = totalLength;
+        incomingMemory.store(nullptr);
+        retiredMemory.store(nullptr);
+        ownedMemory.free();
+        lines = nullptr;
+
+        if (memoryWanted.load()) {
+            ownedMemory.calloc(totalLength);
+            lines = ownedMemory.get();
+        }
+
+        //Fixed 6kHz damping, the decay time does the rest
+        dampingCoefficient = static_cast<SampleType>(1.0 - std::exp(-juce::MathConstants<double>::twoPi * 6000.0 / sampleRate));
+
+        auto modulationStep = juce::MathConstants<double>::twoPi * modulationRateHz / sampleRate;
+        rotationCos = static_cast<SampleType>(std::cos(modulationStep));
+        rotationSin = static_cast<SampleType>(std::sin(modulationStep));
+        modulationDepthSamples = static_cast<SampleType>(modulationDepth);
+
+        size.reset(sampleRate, 0.2);
+        dryGain.reset(sampleRate, 0.05);
+        wetGain.reset(sampleRate, 0.05);
+
+        reset();
+        setParameters(currentParameters);
+        size.setCurrentAndTargetValue(static_cast<SampleType>(currentParameters.size));
+        dryGain.setCurrentAndTargetValue(dryGain.getTargetValue());
+        wetGain.setCurrentAndTargetValue(wetGain.getTargetValue());
+    }
+
+    void reset() noexcept {
+        if (lines != nullptr)
+            std::fill(lines, lines + totalMemoryLength, SampleType(0));
+
+        lowpassState.fill(SampleType(0));
+        writePosition = 0;
+        modulationCos = SampleType(1);
+        modulationSin = SampleType(0);
+    }
+
+    //No allocation, fine to call from processBlock
+    void setParameters(const Parameters& newParameters) noexcept {
+        currentParameters = newParameters;
+
+        size.setTargetValue(static_cast<SampleType>(juce::jlimit(0.f, 1.f, newParameters.size)));
+
+        auto mix = juce::jlimit(0.f, 1.f, newParameters.mix);
+        dryGain.setTargetValue(static_cast<SampleType>(std::cos(mix * juce::MathConstants<float>::halfPi)));
+        wetGain.setTargetValue(static_cast<SampleType>(std::sin(mix * juce::MathConstants<float>::halfPi)));
+
+        //Gain so each pass through a line loses (its delay / decay time) of 60dB, worked out for
+        //the full size lines. Shorter (smaller) lines then decay a little faster, like a smaller room.
+        auto decay = juce::jmax(0.05f, newParameters.decaySeconds);
+        for (size_t i = 0; i < (size_t)numLines; ++i)
+            feedbackGains[i] = static_cast<SampleType>(std::pow(10.0, -3.0 * baseDelaySeconds[i] / decay));
+    }
+
+    const Parameters& getParameters() const noexcept { return currentParameters; }
+
+    //Mix at 0 and done gliding there, so process() would hand the input back unchanged
+    bool isFullyDry() const noexcept {
+        return wetGain.getTargetValue() == SampleType(0) && !wetGain.isSmoothing();
+    }
+
+    //Audio thread. While false the reverb lets go of its delay memory (next time process() runs)
+    //for updateMemory() to free, and passes the input through until it's wanted and allocated again.
+    void setMemoryWanted(bool shouldHaveMemory) noexcept { memoryWanted.store(shouldHaveMemory, std::memory_order_relaxed); }
+
+    //Message thread, call it regularly. Frees the delay memory the audio thread let go of and
+    //allocates it once it's wanted again. The block is only ever handed over through the two
+    //atomics below, so the audio thread never allocates, frees or waits.
+    void updateMemory() {
+        if (retiredMemory.load(std::memory_order_acquire) != nullptr) {
+            ownedMemory.free();
+            retiredMemory.store(nullptr, std::memory_order_release);
+        }
+
+        if (memoryWanted.load(std::memory_order_relaxed) && ownedMemory == nullptr && totalMemoryLength > 0) {
+            ownedMemory.calloc(totalMemoryLength);
+            incomingMemory.store(ownedMemory.get(), std::memory_order_release);
+        }
+    }
+
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept {
+        auto& block = context.getOutputBlock();
+        auto numSamples = (int)block.getNumSamples();
+
+        auto channels = juce::jmin((int)block.getNumChannels(), numChannels);
+
+        //Runs while bypassed too, that's when the memory gets let go of
+        exchangeMemory();
+
+        if (context.isBypassed || lines == nullptr || channels == 0)
+            return;
+
+        for (int c = 0; c < channels; ++c)
+            channelPointers[c] = block.getChannelPointer((size_t)c);
+
+        //Mono feeds both inputs and hears the average of both outputs
+        auto* left = channelPointers[0];
+        auto* right = channels > 1 ? channelPointers[1] : nullptr;
+        auto stereoOnly = channels <= 2;
+
+        auto* delayMemory = lines;
+        auto depth = Vector::expand(modulationDepthSamples);
+        auto damping = Vector::expand(dampingCoefficient);
+        auto householderScale = SampleType(-2) / SampleType(numLines);
+
+        for (int n = 0; n < numSamples; ++n) {
+            SampleType inLeft, inRight;
+
+            if (stereoOnly) {
+                inLeft = left[n];
+                inRight = right != nullptr ? right[n] : inLeft;
+            }
+            else {
+                inLeft = inRight = SampleType(0);
+                for (int c = 0; c < channels; c += 2)
+                    inLeft += channelPointers[c][n];
+                for (int c = 1; c < channels; c += 2)
+                    inRight += channelPointers[c][n];
+
+                inLeft *= inputScale;
+                inRight *= inputScale;
+            }
+
+            auto currentSize = size.getNextValue();
+            auto scale = SampleType(0.3) + SampleType(0.7) * currentSize;
+
+            //Rotating phasor instead of calling sin() per sample. Each line sees it at a different phase.
+            auto newCos = modulationCos * rotationCos - modulationSin * rotationSin;
+            modulationSin = modulationSin * rotationCos + modulationCos * rotationSin;
+            modulationCos = newCos;
+
+            //Delay time of every line this sample
+            for (size_t v = 0; v < numVectors; ++v) {
+                auto offset = v * lanes;
+                auto modulation = Vector::fromRawArray(phaseCos.data() + offset) * modulationCos
+                                + Vector::fromRawArray(phaseSin.data() + offset) * modulationSin;
+
+                auto delay = Vector::fromRawArray(baseDelays.data() + offset) * scale
+                           + depth * (modulation + SampleType(1));
+                delay.copyToRawArray(delayTimes.data() + offset);
+            }
+
+            //Fractional reads, one line at a time
+            for (size_t i = 0; i < (size_t)numLines; ++i) {
+                auto* line = delayMemory + lineOffsets[i];
+                auto mask = (unsigned int)lineLengths[i] - 1;
+
+                auto delay = delayTimes[i];
+                auto whole = (unsigned int)delay;
+                auto fraction = delay - static_cast<SampleType>(whole);
+
+                auto newer = line[(writePosition - whole) & mask];
+                auto older = line[(writePosition - whole - 1) & mask];
+                lineOutputs[i] = newer + fraction * (older - newer);
+            }
+
+            //Damping, decay, output taps and the Householder sum, all across lines
+            SampleType outLeft(0), outRight(0), feedbackSum(0);
+
+            for (size_t v = 0; v < numVectors; ++v) {
+                auto offset = v * lanes;
+                auto lowpass = Vector::fromRawArray(lowpassState.data() + offset);
+                lowpass = lowpass + damping * (Vector::fromRawArray(lineOutputs.data() + offset) - lowpass);
+                lowpass.copyToRawArray(lowpassState.data() + offset);
+
+                outLeft += (lowpass * Vector::fromRawArray(leftOutputSigns.data() + offset)).sum();
+                outRight += (lowpass * Vector::fromRawArray(rightOutputSigns.data() + offset)).sum();
+
+                auto feedback = lowpass * Vector::fromRawArray(feedbackGains.data() + offset);
+                feedback.copyToRawArray(feedbackValues.data() + offset);
+                feedbackSum += feedback.sum();
+            }
+
+            //x - 2/N * sum(x), plus the input for this sample
+            auto reflection = feedbackSum * householderScale;
+            for (size_t v = 0; v < numVectors; ++v) {
+                auto offset = v * lanes;
+                auto mixed = Vector::fromRawArray(feedbackValues.data() + offset) + reflection
+                           + Vector::fromRawArray(leftInputSigns.data() + offset) * inLeft
+                           + Vector::fromRawArray(rightInputSigns.data() + offset) * inRight;
+                mixed.copyToRawArray(feedbackValues.data() + offset);
+            }
+
+            for (size_t i = 0; i < (size_t)numLines; ++i)
+                delayMemory[lineOffsets[i] + (writePosition & ((unsigned int)lineLengths[i] - 1))] = feedbackValues[i];
+
+            ++writePosition;
+
+            auto dry = dryGain.getNextValue();
+            auto wet = wetGain.getNextValue() * outputScale;
+
+            if (!stereoOnly) {
+                //Every channel keeps its own dry signal and taps the shared lines its own way
+                for (int c = 0; c < channels; ++c) {
+                    SampleType out(0);
+                    for (size_t v = 0; v < numVectors; ++v)
+                        out += (Vector::fromRawArray(lowpassState.data() + v * lanes)
+                                * Vector::fromRawArray(outputSigns + (size_t)c * numLines + v * lanes)).sum();
+
+                    auto* samples = channelPointers[c];
+                    samples[n] = dry * samples[n] + wet * out;
+                }
+            }
+            else if (right != nullptr) {
+                left[n] = dry * inLeft + wet * outLeft;
+                right[n] = dry * inRight + wet * outRight;
+            }
+            else {
+                left[n] = dry * inLeft + wet * SampleType(0.5) * (outLeft + outRight);
+            }
+        }
+
+        //Keeps the phasor on the unit circle, rounding would slowly change its level otherwise
+        auto magnitude = std::sqrt(modulationCos * modulationCos + modulationSin * modulationSin);
+        modulationCos /= magnitude;
+        modulationSin /= magnitude;
+    }
+
+private:
+    //Audio thread side of updateMemory()
+    void exchangeMemory() noexcept {
+        //Freshly allocated, so already silent. The rest of the state starts over with it.
+        if (auto* fresh = incomingMemory.exchange(nullptr, std::memory_order_acq_rel)) {
+            lines = fresh;
+            reset();
+        }
+
+        if (lines != nullptr && !memoryWanted.load(std::memory_order_relaxed)
+            && retiredMemory.load(std::memory_order_acquire) == nullptr) {
+            retiredMemory.store(lines, std::memory_order_release);
+            lines = nullptr;
+        }
+    }
+
+   #if JUCE_USE_SIMD
+    using Vector = juce::dsp::SIMDRegister<SampleType>;
+   #else
+    //One lane stand-in with the bits of SIMDRegister used above
+    struct Vector {
+        static constexpr size_t SIMDNumElements = 1;
+        SampleType value;
+
+        static Vector expand(SampleType s) noexcept { return { s }; }
+        static Vector fromRawArray(const SampleType* source) noexcept { return { *source }; }
+        void copyToRawArray(SampleType* destination) const noexcept { *destination = value; }
+        SampleType sum() const noexcept { return value; }
+
+        Vector operator+(Vector other) const noexcept { return { value + other.value }; }
+        Vector operator-(Vector other) const noexcept { return { value - other.value }; }
+        Vector operator*(Vector other) const noexcept { return { value * other.value }; }
+        Vector operator+(SampleType other) const noexcept { return { value + other }; }
+        Vector operator*(SampleType other) const noexcept { return { value * other }; }
+    };
+   #endif
+
+    static constexpr size_t lanes = Vector::SIMDNumElements;
+    static constexpr size_t numVectors = (size_t)numLines / lanes;
+    static_assert((size_t)numLines % lanes == 0, "Lines must fill whole SIMD registers");
+
+    template <typename Type>
+    using LineArray = std::array<Type, (size_t)numLines>;
+
+    //Mutually prime-ish lengths (ms) so the echoes don't line up
+    static constexpr double baseDelaySeconds[numLines] = { 0.0297, 0.0371, 0.0411, 0.0437, 0.0533, 0.0599, 0.0677, 0.0731 };
+    static constexpr double modulationDepthSeconds = 0.0006;
+    static constexpr double modulationRateHz = 0.7;
+
+    //Spread the wet level across 8 lines back to roughly unity
+    static constexpr SampleType outputScale = SampleType(0.35);
+
+    //Per line constants, every array starts on a 64 byte boundary so SIMD loads are aligned
+    alignas(64) LineArray<SampleType> baseDelays{};
+    alignas(64) LineArray<SampleType> feedbackGains{};
+    alignas(64) LineArray<SampleType> phaseCos{ SampleType(1), SampleType(0.7071), SampleType(0), SampleType(-0.7071),
+                                                SampleType(-1), SampleType(-0.7071), SampleType(0), SampleType(0.7071) };
+    alignas(64) LineArray<SampleType> phaseSin{ SampleType(0), SampleType(0.7071), SampleType(1), SampleType(0.7071),
+                                                SampleType(0), SampleType(-0.7071), SampleType(-1), SampleType(-0.7071) };
+    alignas(64) LineArray<SampleType> leftInputSigns{ SampleType(1), SampleType(-1), SampleType(1), SampleType(-1), 0, 0, 0, 0 };
+    alignas(64) LineArray<SampleType> rightInputSigns{ 0, 0, 0, 0, SampleType(1), SampleType(-1), SampleType(1), SampleType(-1) };
+    alignas(64) LineArray<SampleType> leftOutputSigns{ SampleType(1), SampleType(1), SampleType(-1), SampleType(1),
+                                                       SampleType(-1), SampleType(1), SampleType(1), SampleType(-1) };
+    alignas(64) LineArray<SampleType> rightOutputSigns{ SampleType(1), SampleType(-1), SampleType(1), SampleType(1),
+                                                        SampleType(1), SampleType(-1), SampleType(-1), SampleType(-1) };
+
+    //Per sample scratch and state
+    alignas(64) LineArray<SampleType> delayTimes{};
+    alignas(64) LineArray<SampleType> lineOutputs{};
+    alignas(64) LineArray<SampleType> feedbackValues{};
+    alignas(64) LineArray<SampleType> lowpassState{};
+
+    //Output taps per channel and the channel pointers of the current block, sized in prepare()
+    juce::HeapBlock<char> outputSignsMemory;
+    SampleType* outputSigns{ nullptr };
+    juce::HeapBlock<SampleType*> channelPointers;
+    SampleType inputScale{ 1 };
+
+    //Every delay line back to back in one block. Only prepare() and updateMemory() allocate or
+    //free it, the audio thread reads it through lines once it's been handed over.
+    juce::HeapBlock<SampleType> ownedMemory;
+    SampleType* lines{ nullptr };
+    std::atomic<SampleType*> incomingMemory{ nullptr }, retiredMemory{ nullptr };
+    std::atomic<bool> memoryWanted{ true };
+    size_t totalMemoryLength{ 0 };
+    LineArray<int> lineLengths{};
+    LineArray<size_t> lineOffsets{};
+    unsigned int writePosition{ 0 };
+
+    SampleType dampingCoefficient{ 0 }, modulationDepthSamples{ 0 };
+    SampleType rotationCos{ 1 }, rotationSin{ 0 }, modulationCos{ 1 }, modulationSin{ 0 };
+
+    juce::SmoothedValue<SampleType> size, dryGain, wetGain;
+    Parameters currentParameters;
+
+    double sampleRate{ 44100.0 };
+    int numChannels{ 2 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FDNReverb)
+};
@@ -0,0 +1,311 @@
+/*
+  ==============================================================================
+
+    LinearPhaseCuts.cpp
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseCuts.h"
+#include "RealtimeSafety.h"
+
+//==============================================================================
+//One thread shared by every instance that builds their kernels. It polls, so asking for a
+//kernel on the audio thread is only a few atomic stores.
+class LinearPhaseCuts::Designer : public juce::Thread {
+public:
+    Designer() : juce::Thread("WeirdEffects Linear Phase Designer") {
+        startThread();
+    }
+
+    ~Designer() override {
+        stopThread(4000);
+    }
+
+    //Message thread only. Once remove() returns the designer won't touch that instance again.
+    void add(LinearPhaseCuts* cuts) {
+        const RealtimeSafety::ScopedLock lock(clientLock);
+        clients.addIfNotAlreadyThere(cuts);
+        notify();
+    }
+
+    void remove(LinearPhaseCuts* cuts) {
+        const RealtimeSafety::ScopedLock lock(clientLock);
+        clients.removeFirstMatchingValue(cuts);
+    }
+
+    void run() override {
+        while (!threadShouldExit()) {
+            bool anyClients;
+
+            {
+                const RealtimeSafety::ScopedLock lock(clientLock);
+                for (auto* client : clients)
+                    client->designIfRequested();
+                anyClients = !clients.isEmpty();
+            }
+
+            //A cut being dragged only needs a new kernel every few blocks, and the latency hides the rest
+            wait(anyClients ? 10 : 50);
+        }
+    }
+
+private:
+    juce::CriticalSection clientLock;
+    juce::Array<LinearPhaseCuts*> clients;
+};
+
+//==============================================================================
+LinearPhaseCuts::LinearPhaseCuts() = default;
+
+LinearPhaseCuts::~LinearPhaseCuts() {
+    release();
+}
+
+void LinearPhaseCuts::prepare(const juce::dsp::ProcessSpec& spec) {
+    //Nothing else can be designing for this instance after this
+    release();
+
+    numChannels = juce::jmax(1, (int)spec.numChannels);
+
+    {
+        const RealtimeSafety::ScopedLock lock(poolLock);
+        sampleRate = spec.sampleRate;
+
+        //About 170ms of kernel resolves a 20Hz corner, rounded so the design FFT is a power of two.
+        //Odd length keeps the group delay a whole number of samples.
+        auto taps = juce::nextPowerOfTwo((int)std::ceil(0.17 * sampleRate));
+        numTaps = juce::jmin(taps, 16384) - 1;
+        designSize = 2 * (numTaps + 1);
+
+        designFFT = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2(designSize)));
+        partitionFFT = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2(2 * partitionSize)));
+
+        //Every bin of the design FFT from DC to nyquist
+        auto numBins = designSize / 2 + 1;
+        designFrequencies.resize((size_t)numBins);
+        for (int k = 0; k < numBins; ++k)
+            designFrequencies[(size_t)k] = (float)(k * sampleRate / designSize);
+
+        response.prepare(designFrequencies.data(), numBins, sampleRate);
+        designDecibels.resize((size_t)numBins);
+        designBuffer.resize((size_t)designSize * 2);
+        kernel.resize((size_t)numTaps);
+        partitionScratch.resize((size_t)partitionSize * 4);
+
+        window.resize((size_t)numTaps);
+        juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), (size_t)numTaps,
+                                                                 juce::dsp::WindowingFunction<float>::blackman, false);
+
+        //Kernels for the old sample rate are useless now
+        pendingKernel.store(nullptr);
+        current = nullptr;
+        previous = nullptr;
+        pool.clear();
+        oldestGenerationInUse.store(lastGeneration + 1);
+    }
+
+    auto numPartitions = (numTaps + partitionSize - 1) / partitionSize;
+    convolvers.resize((size_t)numChannels);
+    for (auto& convolver : convolvers)
+        convolver.prepare(partitionSize, numPartitions);
+
+    input.setSize(numChannels, partitionSize);
+    output.setSize(numChannels, partitionSize);
+    fadeOutput.setSize(numChannels, partitionSize);
+
+    //One partition collecting input, then the kernel's centre tap
+    latencySamples = partitionSize + (numTaps - 1) / 2;
+
+    reset();
+
+    designer->add(this);
+    registeredWithDesigner = true;
+}
+
+void LinearPhaseCuts::release() {
+    if (registeredWithDesigner) {
+        designer->remove(this);
+        registeredWithDesigner = false;
+    }
+}
+
+void LinearPhaseCuts::reset() noexcept {
+    input.clear();
+    output.clear();
+    fadeOutput.clear();
+
+    for (auto& convolver : convolvers)
+        convolver.reset();
+
+    position = 0;
+}
+
+void LinearPhaseCuts::setTargets(float lowCutFrequency, int lowSections, float highCutFrequency, int highSections) noexcept {
+    requestedLowCut.store(lowCutFrequency, std::memory_order_relaxed);
+    requestedLowSections.store(lowSections, std::memory_order_relaxed);
+    requestedHighCut.store(highCutFrequency, std::memory_order_relaxed);
+    requestedHighSections.store(highSections, std::memory_order_relaxed);
+    requestVersion.fetch_add(1, std::memory_order_release);
+}
+
+void LinearPhaseCuts::snapToTargets() {
+    const RealtimeSafety::ScopedLock lock(poolLock);
+    if (sampleRate <= 0.0)
+        return;
+
+    designedVersion = requestVersion.load(std::memory_order_acquire);
+    auto fresh = design(requestedLowCut.load(), requestedLowSections.load(), requestedHighCut.load(), requestedHighSections.load());
+
+    fresh->generation = ++lastGeneration;
+    pool.add(fresh);
+
+    pendingKernel.store(nullptr);
+    current = fresh.get();
+    previous = nullptr;
+    oldestGenerationInUse.store(fresh->generation, std::memory_order_release);
+
+    releaseUnusedKernels();
+}
+
+void LinearPhaseCuts::designIfRequested() {
+    const RealtimeSafety::ScopedLock lock(poolLock);
+
+    auto version = requestVersion.load(std::memory_order_acquire);
+    if (version != designedVersion && sampleRate > 0.0) {
+        designedVersion = version;
+
+        //If the audio thread moves the cuts again halfway through reading these, the version has
+        //gone up again as well and the next poll designs the right kernel
+        publish(design(requestedLowCut.load(std::memory_order_relaxed), requestedLowSections.load(std::memory_order_relaxed),
+                       requestedHighCut.load(std::memory_order_relaxed), requestedHighSections.load(std::memory_order_relaxed)));
+    }
+    else {
+        releaseUnusedKernels();
+    }
+}
+
+LinearPhaseKernel::Ptr LinearPhaseCuts::design(float lowCutFrequency, int lowSections, float highCutFrequency, int highSections) {
+    //Magnitude of the Butterworth cascade at every bin, exactly what the other cut modes would do
+    auto lowCut = CutFilterDesign::makeLowCut(lowCutFrequency, sampleRate, lowSections);
+    auto highCut = CutFilterDesign::makeHighCut(highCutFrequency, sampleRate, highSections);
+    response.process(lowCut, highCut, 0.f, designDecibels.data());
+
+    //Zero phase spectrum, so the inverse transform is a real impulse centred on sample 0
+    std::fill(designBuffer.begin(), designBuffer.end(), 0.f);
+    for (size_t k = 0; k < designDecibels.size(); ++k)
+        designBuffer[k * 2] = juce::Decibels::decibelsToGain(designDecibels[k], CutFilterResponse::floorDecibels);
+
+    designFFT->performRealOnlyInverseTransform(designBuffer.data());
+
+    //Rotate the centre into the middle of the kernel and window it, which is what makes it causal
+    //and keeps the ripple of truncating it far below the stopband
+    auto half = (numTaps - 1) / 2;
+    for (int i = 0; i < numTaps; ++i)
+        kernel[(size_t)i] = designBuffer[(size_t)((i - half + designSize) % designSize)] * window[(size_t)i];
+
+    LinearPhaseKernel::Ptr result = new LinearPhaseKernel();
+    result->segment = ConvolutionImpulse::makeSegment(kernel.data(), numTaps, 0, numTaps, partitionSize, *partitionFFT, partitionScratch);
+    return result;
+}
+
+void LinearPhaseCuts::publish(LinearPhaseKernel::Ptr fresh) {
+    //Under poolLock, from designIfRequested()
+    fresh->generation = ++lastGeneration;
+    pool.add(fresh);
+    pendingKernel.store(fresh.get(), std::memory_order_release);
+
+    releaseUnusedKernels();
+}
+
+void LinearPhaseCuts::releaseUnusedKernels() {
+    //The audio thread only ever moves on to newer kernels, and says which is the oldest it may
+    //still read (the one it's fading away from, or else the one it's using). A pending kernel is
+    //always the newest, so it's never older than that.
+    auto oldest = oldestGenerationInUse.load(std::memory_order_acquire);
+
+    for (int i = pool.size(); --i >= 0;)
+        if (pool.getUnchecked(i)->generation < oldest)
+            pool.remove(i);
+}
+
+template <typename SampleType>
+void LinearPhaseCuts::process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept {
+    auto& block = context.getOutputBlock();
+    auto channels = juce::jmin((int)block.getNumChannels(), numChannels);
+    auto numSamples = (int)block.getNumSamples();
+
+    if (context.isBypassed || channels == 0)
+        return;
+
+    for (int offset = 0; offset < numSamples;) {
+        auto count = juce::jmin(numSamples - offset, partitionSize - position);
+
+        //In goes this partition, out comes the one convolved at the last boundary
+        for (int c = 0; c < channels; ++c) {
+            auto* samples = block.getChannelPointer((size_t)c) + offset;
+            auto* in = input.getWritePointer(c) + position;
+            auto* out = output.getReadPointer(c) + position;
+
+            for (int i = 0; i < count; ++i) {
+                in[i] = static_cast<float>(samples[i]);
+                samples[i] = static_cast<SampleType>(out[i]);
+            }
+        }
+
+        position += count;
+        offset += count;
+
+        if (position == partitionSize) {
+            processPartition(channels);
+            position = 0;
+        }
+    }
+}
+
+template void LinearPhaseCuts::process<float>(const juce::dsp::ProcessContextReplacing<float>&) noexcept;
+template void LinearPhaseCuts::process<double>(const juce::dsp::ProcessContextReplacing<double>&) noexcept;
+
+void LinearPhaseCuts::processPartition(int channels) noexcept {
+    //Pick up a kernel the designer finished since the last partition. It's kept alive by the pool.
+    //With no kernel before it, it fades in from silence.
+    auto fading = false;
+    if (auto* fresh = pendingKernel.exchange(nullptr, std::memory_order_acq_rel)) {
+        previous = current;
+        current = fresh;
+        fading = true;
+        oldestGenerationInUse.store(previous != nullptr ? previous->generation : current->generation, std::memory_order_release);
+    }
+
+    for (int c = 0; c < channels; ++c) {
+        auto& convolver = convolvers[(size_t)c];
+        auto* out = output.getWritePointer(c);
+
+        //The input history is shared, so fading between kernels costs one more convolve, not another FFT of the input
+        convolver.pushInput(input.getReadPointer(c));
+
+        if (current != nullptr)
+            convolver.convolve(current->segment, out);
+        else
+            std::fill(out, out + partitionSize, 0.f);
+
+        if (fading) {
+            auto* old = fadeOutput.getWritePointer(c);
+            if (previous != nullptr)
+                convolver.convolve(previous->segment, old);
+            else
+                std::fill(old, old + partitionSize, 0.f);
+
+            //Both kernels see the same input and differ only slightly, so a linear fade doesn't dip
+            for (int i = 0; i < partitionSize; ++i) {
+                auto amount = (float)(i + 1) / (float)partitionSize;
+                out[i] = old[i] + amount * (out[i] - old[i]);
+            }
+        }
+    }
+
+    if (fading) {
+        previous = nullptr;
+        oldestGenerationInUse.store(current->generation, std::memory_order_release);
+    }
+}
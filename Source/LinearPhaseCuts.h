@@ -0,0 +1,118 @@
+/*
+  ==============================================================================
+
+    LinearPhaseCuts.h
+
+    LowCut + HighCut as one linear phase FIR, run with partitioned convolution.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ConvolutionReverb.h"
+#include "CutFilterResponse.h"
+
+//One FIR kernel with the magnitude of the Butterworth LowCut -> HighCut cascade and no phase
+//shift, already cut into uniform partitions. Built off the audio thread and never changed after.
+class LinearPhaseKernel : public juce::ReferenceCountedObject {
+public:
+    using Ptr = juce::ReferenceCountedObjectPtr<LinearPhaseKernel>;
+
+    ConvolutionImpulse::Segment segment;
+    //Order of publication, newer kernels have bigger numbers
+    juce::uint64 generation{ 0 };
+};
+
+//The "Linear Phase" cut mode, for mastering. Designs an FIR whose magnitude matches the
+//selected cut frequencies and slopes exactly (frequency sampling of the Butterworth response,
+//windowed), and runs it through a PartitionConvolver per channel with uniform partitions.
+//
+//That costs getLatencySamples() of latency: one partition of buffering plus half the kernel.
+//
+//Moving a cut only asks for a new kernel. A designer thread shared by every instance builds it
+//and the audio thread crossfades from the old kernel to the new one over one partition, so
+//nothing is designed, allocated or locked in process(). The cut modulation doesn't apply here,
+//a kernel per sample is exactly what this mode can't do.
+//
+//Has prepare/reset/process like the other stages, process works on float or double blocks.
+//The convolution itself is float (juce::dsp::FFT is), so a double block comes back with float
+//precision. There's no dry signal in here to keep at the block's precision, the whole output
+//is filtered.
+class LinearPhaseCuts {
+public:
+    static constexpr int partitionSize = 512;
+
+    LinearPhaseCuts();
+    ~LinearPhaseCuts();
+
+    //Sizes the kernel for the sample rate and allocates everything. Starts with no kernel (silence)
+    //until snapToTargets() or the designer provides one.
+    void prepare(const juce::dsp::ProcessSpec& spec);
+    void reset() noexcept;
+    void release();
+
+    //Partition buffering plus the kernel's group delay, fixed for a sample rate
+    int getLatencySamples() const noexcept { return latencySamples; }
+
+    //Audio thread. Only stores the request, the designer picks it up.
+    void setTargets(float lowCutFrequency, int lowSections, float highCutFrequency, int highSections) noexcept;
+
+    //Message thread, after prepare() and setTargets() and while process() can't run. Builds the
+    //requested kernel here and uses it straight away instead of crossfading.
+    void snapToTargets();
+
+    template <typename SampleType>
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept;
+
+private:
+    class Designer;
+    friend class Designer;
+
+    //Designer thread (or snapToTargets). Builds a kernel if the request changed since the last one.
+    void designIfRequested();
+    LinearPhaseKernel::Ptr design(float lowCutFrequency, int lowSections, float highCutFrequency, int highSections);
+    void publish(LinearPhaseKernel::Ptr kernel);
+    void releaseUnusedKernels();
+
+    //Every partitionSize samples on the audio thread
+    void processPartition(int channels) noexcept;
+
+    //The request, written by the audio thread. The version goes up after the values are written.
+    std::atomic<float> requestedLowCut{ 20.f }, requestedHighCut{ 20000.f };
+    std::atomic<int> requestedLowSections{ 1 }, requestedHighSections{ 1 };
+    std::atomic<juce::uint32> requestVersion{ 0 };
+    juce::uint32 designedVersion{ 0 };
+
+    //Everything built so far, only the designer and message thread add or remove, under poolLock
+    juce::CriticalSection poolLock;
+    juce::ReferenceCountedArray<LinearPhaseKernel> pool;
+    juce::uint64 lastGeneration{ 0 };
+
+    std::atomic<LinearPhaseKernel*> pendingKernel{ nullptr };
+    //Oldest kernel the audio thread might still read, anything older can be freed
+    std::atomic<juce::uint64> oldestGenerationInUse{ 0 };
+
+    //Design state, only used under poolLock
+    int numTaps{ 0 }, designSize{ 0 };
+    std::unique_ptr<juce::dsp::FFT> designFFT, partitionFFT;
+    std::vector<float> designFrequencies, designDecibels, designBuffer, window, kernel, partitionScratch;
+    CutFilterResponse response;
+
+    //Audio thread state
+    LinearPhaseKernel* current{ nullptr };
+    //Only set for the partition that crossfades away from it
+    LinearPhaseKernel* previous{ nullptr };
+    std::vector<PartitionConvolver> convolvers;
+    juce::AudioBuffer<float> input, output, fadeOutput;
+    int position{ 0 };
+
+    double sampleRate{ 0 };
+    int numChannels{ 0 }, latencySamples{ 0 };
+    bool registeredWithDesigner{ false };
+
+    juce::SharedResourcePointer<Designer> designer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LinearPhaseCuts)
+};
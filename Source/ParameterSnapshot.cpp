@@ -0,0 +1,145 @@
+/*
+  ==============================================================================
+
+    ParameterSnapshot.cpp
+
+  ==============================================================================
+*/
+
+#include "ParameterSnapshot.h"
+
+//Same order as the ChainParameter enum
+static const char* const chainParameterIDs[NumChainParameters] = {
+    "Gain",
+    "Dry/Wet",
+    "Reverb",
+    "LowCut Freq",
+    "HighCut Freq",
+    "Low-Cut Slope",
+    "High-Cut Slope",
+    "Reverb Mode",
+    "Morph",
+    "Cut Mode",
+    "Mod Rate",
+    "Mod Depth",
+    "Mod Envelope",
+    "Block Mode",
+    "Drive",
+    "Shape",
+    "Crush Rate",
+    "Crush Bits",
+    "Oversampling",
+    "Oversampling Quality",
+};
+
+const char* ParameterSnapshot::getParameterID(ChainParameter parameter) noexcept {
+    return chainParameterIDs[(size_t)parameter];
+}
+
+ParameterSnapshot::ParameterSnapshot(juce::AudioProcessorValueTreeState& tree) {
+    for (int i = 0; i < NumChainParameters; ++i) {
+        auto& handle = handles[(size_t)i];
+        handle.owner = this;
+        handle.index = static_cast<ChainParameter>(i);
+        handle.parameter = tree.getParameter(chainParameterIDs[i]);
+        jassert(handle.parameter != nullptr);
+
+        values[(size_t)i].store(tree.getRawParameterValue(chainParameterIDs[i])->load());
+        versions[(size_t)i].store(0);
+
+        handle.parameter->addListener(&handle);
+    }
+}
+
+ParameterSnapshot::~ParameterSnapshot() {
+    for (auto& handle : handles)
+        handle.parameter->removeListener(&handle);
+}
+
+void ParameterSnapshot::Handle::parameterValueChanged(int, float newValue) {
+    //Can be called from the audio thread during automation, so only atomics in here.
+    //newValue is normalised, converting back is just the range maths.
+    owner->values[(size_t)index].store(parameter->convertFrom0to1(newValue), std::memory_order_relaxed);
+
+    //Bump the parameter before the global counter so a Reader that sees the new global
+    //version is guaranteed to see which parameter moved
+    owner->versions[(size_t)index].fetch_add(1, std::memory_order_release);
+    owner->globalVersion.fetch_add(1, std::memory_order_release);
+}
+
+ChainSettings ParameterSnapshot::getSettings() const noexcept {
+    ChainSettings settings;
+
+    settings.gain = get(GainParameter);
+    settings.dryWet = get(DryWetParameter);
+    settings.reverb = get(ReverbParameter);
+    settings.lowCutFreq = get(LowCutFreqParameter);
+    settings.highCutFreq = get(HighCutFreqParameter);
+    settings.lowCutSlope = static_cast<Slope>(static_cast<int>(get(LowCutSlopeParameter)));
+    settings.highCutSlope = static_cast<Slope>(static_cast<int>(get(HighCutSlopeParameter)));
+    settings.reverbMode = static_cast<ReverbMode>(static_cast<int>(get(ReverbModeParameter)));
+    settings.cutMode = static_cast<CutMode>(static_cast<int>(get(CutModeParameter)));
+    settings.modRate = get(ModRateParameter);
+    settings.modDepth = get(ModDepthParameter);
+    settings.modEnvelope = get(ModEnvelopeParameter);
+    settings.blockMode = static_cast<BlockMode>(static_cast<int>(get(BlockModeParameter)));
+    settings.drive = get(DriveParameter);
+    settings.shape = static_cast<Shape>(static_cast<int>(get(ShapeParameter)));
+    settings.crushRate = get(CrushRateParameter);
+    settings.crushBits = get(CrushBitsParameter);
+    settings.oversampling = static_cast<OversamplingFactor>(static_cast<int>(get(OversamplingParameter)));
+    settings.oversamplingQuality = static_cast<OversamplingQuality>(static_cast<int>(get(OversamplingQualityParameter)));
+
+    return settings;
+}
+
+juce::uint32 ParameterSnapshot::Reader::pollChanges(const ParameterSnapshot& snapshot) noexcept {
+    //Nothing moved anywhere since last time, which is almost every block
+    auto global = snapshot.globalVersion.load(std::memory_order_acquire);
+    if (!forceAll && global == lastGlobalVersion)
+        return 0;
+
+    lastGlobalVersion = global;
+
+    juce::uint32 changed = forceAll ? allMask : 0;
+    forceAll = false;
+
+    for (size_t i = 0; i < (size_t)NumChainParameters; ++i) {
+        auto version = snapshot.versions[i].load(std::memory_order_acquire);
+        if (version != lastVersions[i]) {
+            lastVersions[i] = version;
+            changed |= 1u << i;
+        }
+    }
+
+    return changed;
+}
+
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& tree) {
+
+    ChainSettings settings;
+
+    //Use getRawParameterValue instead of getParameterValue because we don't want
+    //normalized value.
+    settings.gain = tree.getRawParameterValue("Gain")->load();
+    settings.dryWet = tree.getRawParameterValue("Dry/Wet")->load();
+    settings.reverb = tree.getRawParameterValue("Reverb")->load();
+    settings.lowCutFreq = tree.getRawParameterValue("LowCut Freq")->load();
+    settings.highCutFreq = tree.getRawParameterValue("HighCut Freq")->load();
+    settings.lowCutSlope = static_cast<Slope>(static_cast<int>(tree.getRawParameterValue("Low-Cut Slope")->load()));
+    settings.highCutSlope = static_cast<Slope>(static_cast<int>(tree.getRawParameterValue("High-Cut Slope")->load()));
+    settings.reverbMode = static_cast<ReverbMode>(static_cast<int>(tree.getRawParameterValue("Reverb Mode")->load()));
+    settings.cutMode = static_cast<CutMode>(static_cast<int>(tree.getRawParameterValue("Cut Mode")->load()));
+    settings.modRate = tree.getRawParameterValue("Mod Rate")->load();
+    settings.modDepth = tree.getRawParameterValue("Mod Depth")->load();
+    settings.modEnvelope = tree.getRawParameterValue("Mod Envelope")->load();
+    settings.blockMode = static_cast<BlockMode>(static_cast<int>(tree.getRawParameterValue("Block Mode")->load()));
+    settings.drive = tree.getRawParameterValue("Drive")->load();
+    settings.shape = static_cast<Shape>(static_cast<int>(tree.getRawParameterValue("Shape")->load()));
+    settings.crushRate = tree.getRawParameterValue("Crush Rate")->load();
+    settings.crushBits = tree.getRawParameterValue("Crush Bits")->load();
+    settings.oversampling = static_cast<OversamplingFactor>(static_cast<int>(tree.getRawParameterValue("Oversampling")->load()));
+    settings.oversamplingQuality = static_cast<OversamplingQuality>(static_cast<int>(tree.getRawParameterValue("Oversampling Quality")->load()));
+
+    return settings;
+}
@@ -0,0 +1,176 @@
+/*
+  ==============================================================================
+
+    ParameterSnapshot.h
+
+    Cached parameter handles with per-parameter change tracking.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+enum Slope {
+    Slope_12dB,
+    Slope_24dB,
+    Slope_36dB,
+};
+
+enum ReverbMode {
+    ReverbMode_Algorithmic,
+    ReverbMode_Convolution,
+};
+
+//Topology of the LowCut/HighCut stages
+enum CutMode {
+    CutMode_Butterworth,
+    CutMode_StateVariable,
+    CutMode_LinearPhase,
+};
+
+//How processBlock splits up what the host sends
+enum BlockMode {
+    BlockMode_ZeroLatency,
+    BlockMode_Fixed,
+};
+
+//Curve of the waveshaper stage. Off leaves only the bit and sample rate reduction.
+enum Shape {
+    Shape_Off,
+    Shape_Tanh,
+    Shape_Foldback,
+    Shape_Asymmetric,
+};
+
+//Rate the waveshaper runs at, 2 to the power of the value times the host's
+enum OversamplingFactor {
+    OversamplingFactor_Off,
+    OversamplingFactor_2x,
+    OversamplingFactor_4x,
+    OversamplingFactor_8x,
+};
+
+//Half band filters of the oversampling: polyphase IIR, the same with steeper filters, or linear phase FIR
+enum OversamplingQuality {
+    OversamplingQuality_LowLatency,
+    OversamplingQuality_Balanced,
+    OversamplingQuality_LinearPhase,
+};
+
+//Struct for storing current parameter values
+struct ChainSettings {
+    float highCutFreq{ 0 }, lowCutFreq{ 0 };
+    Slope highCutSlope{Slope::Slope_12dB}, lowCutSlope{Slope::Slope_12dB};
+    float gain{ 0 }, dryWet{ 0 };
+    float reverb{ 0 };
+    ReverbMode reverbMode{ ReverbMode::ReverbMode_Algorithmic };
+    CutMode cutMode{ CutMode::CutMode_Butterworth };
+    //Cut frequency modulation: LFO rate in Hz, LFO depth and envelope amount in octaves
+    float modRate{ 1.f }, modDepth{ 0 }, modEnvelope{ 0 };
+    BlockMode blockMode{ BlockMode::BlockMode_ZeroLatency };
+    //Waveshaper: drive in dB, sample and hold period in samples, quantiser resolution in bits
+    Shape shape{ Shape::Shape_Off };
+    float drive{ 0 }, crushRate{ 1.f }, crushBits{ 24.f };
+    OversamplingFactor oversampling{ OversamplingFactor::OversamplingFactor_Off };
+    OversamplingQuality oversamplingQuality{ OversamplingQuality::OversamplingQuality_LowLatency };
+};
+
+//Does a string lookup per parameter, fine for one-off reads but use ParameterSnapshot in processBlock
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState & Tree);
+
+//Every parameter the chain reads, also used as the bit index in a change mask
+enum ChainParameter {
+    GainParameter,
+    DryWetParameter,
+    ReverbParameter,
+    LowCutFreqParameter,
+    HighCutFreqParameter,
+    LowCutSlopeParameter,
+    HighCutSlopeParameter,
+    ReverbModeParameter,
+    MorphParameter,
+    CutModeParameter,
+    ModRateParameter,
+    ModDepthParameter,
+    ModEnvelopeParameter,
+    BlockModeParameter,
+    DriveParameter,
+    ShapeParameter,
+    CrushRateParameter,
+    CrushBitsParameter,
+    OversamplingParameter,
+    OversamplingQualityParameter,
+    NumChainParameters,
+};
+
+//Finds every parameter once at construction and listens to it, so reading the settings is a
+//handful of atomic loads instead of seven string-keyed getRawParameterValue lookups.
+//
+//Each parameter has a version counter that goes up whenever the host or the GUI moves it,
+//plus one global counter that goes up on any change. A Reader remembers the versions it has
+//seen, so when nothing moved, asking what changed is a single atomic compare.
+class ParameterSnapshot {
+public:
+    //Change masks for each stage of the chain
+    static constexpr juce::uint32 cutMask = (1u << LowCutFreqParameter) | (1u << HighCutFreqParameter)
+                                          | (1u << LowCutSlopeParameter) | (1u << HighCutSlopeParameter)
+                                          | (1u << CutModeParameter);
+    static constexpr juce::uint32 modulationMask = (1u << ModRateParameter) | (1u << ModDepthParameter) | (1u << ModEnvelopeParameter);
+    static constexpr juce::uint32 gainMask = 1u << GainParameter;
+    static constexpr juce::uint32 reverbMask = (1u << ReverbParameter) | (1u << ReverbModeParameter);
+    static constexpr juce::uint32 dryWetMask = 1u << DryWetParameter;
+    static constexpr juce::uint32 morphMask = 1u << MorphParameter;
+    static constexpr juce::uint32 blockMask = 1u << BlockModeParameter;
+    static constexpr juce::uint32 shaperMask = (1u << DriveParameter) | (1u << ShapeParameter)
+                                             | (1u << CrushRateParameter) | (1u << CrushBitsParameter);
+    static constexpr juce::uint32 oversamplingMask = (1u << OversamplingParameter) | (1u << OversamplingQualityParameter);
+    static constexpr juce::uint32 allMask = (1u << NumChainParameters) - 1;
+
+    explicit ParameterSnapshot(juce::AudioProcessorValueTreeState& tree);
+    ~ParameterSnapshot();
+
+    //Each thread that wants to know what changed keeps its own Reader
+    class Reader {
+    public:
+        //Returns a mask of (1 << ChainParameter) bits for everything that changed since the last call.
+        //The first call after construction or markAllChanged() reports everything.
+        juce::uint32 pollChanges(const ParameterSnapshot& snapshot) noexcept;
+
+        void markAllChanged() noexcept { forceAll = true; }
+
+    private:
+        juce::uint32 lastGlobalVersion{ 0 };
+        std::array<juce::uint32, NumChainParameters> lastVersions{};
+        bool forceAll{ true };
+    };
+
+    //Lock free, allocation free, safe on any thread
+    float get(ChainParameter parameter) const noexcept { return values[(size_t)parameter].load(std::memory_order_relaxed); }
+    ChainSettings getSettings() const noexcept;
+
+    //The parameter behind each ChainParameter, for restoring state and recalling presets
+    juce::RangedAudioParameter& getParameter(ChainParameter parameter) const noexcept { return *handles[(size_t)parameter].parameter; }
+    static const char* getParameterID(ChainParameter parameter) noexcept;
+
+private:
+    //One listener per parameter so the callback knows which bit to bump without comparing strings
+    struct Handle : public juce::AudioProcessorParameter::Listener {
+        void parameterValueChanged(int parameterIndex, float newValue) override;
+        void parameterGestureChanged(int, bool) override {}
+
+        ParameterSnapshot* owner{ nullptr };
+        juce::RangedAudioParameter* parameter{ nullptr };
+        ChainParameter index{ GainParameter };
+    };
+
+    std::array<Handle, NumChainParameters> handles;
+
+    //Plain (not normalised) values, written by the listeners
+    std::array<std::atomic<float>, NumChainParameters> values;
+    std::array<std::atomic<juce::uint32>, NumChainParameters> versions;
+    std::atomic<juce::uint32> globalVersion{ 1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ParameterSnapshot)
+};
@@ -11,7 +11,32 @@
 
 //==============================================================================
 WeirdEffectsAudioProcessorEditor::WeirdEffectsAudioProcessorEditor(WeirdEffectsAudioProcessor& p)
-    : AudioProcessorEditor(&p), audioProcessor(p) {   
+    : AudioProcessorEditor(&p), audioProcessor(p), spectrumDisplay(p.getSpectrumAnalyzer()),
+      responseCurve(p, p.getParameterSnapshot()), parameterEditor(p) {   
+            addAndMakeVisible(spectrumDisplay);
+            addAndMakeVisible(responseCurve);
+            addAndMakeVisible(parameterEditor);
+
+            addAndMakeVisible(loadImpulseButton);
+            loadImpulseButton.onClick = [this] { chooseImpulseResponse(); };
+            addAndMakeVisible(impulseLabel);
+            updateImpulseLabel();
+
+            //Item ids are preset index + 2, so id 1 is "Morph off"
+            for (auto* box : { &morphPresetA, &morphPresetB }) {
+                box->addItem("Morph off", 1);
+                for (int i = 0; i < PresetBank::getNumPresets(); ++i)
+                    box->addItem(PresetBank::getPreset(i).name, i + 2);
+
+                box->onChange = [this] { updateMorphPresets(); };
+                addAndMakeVisible(*box);
+            }
+            morphPresetA.setSelectedId(audioProcessor.getMorphPresetA() + 2, juce::dontSendNotification);
+            morphPresetB.setSelectedId(audioProcessor.getMorphPresetB() + 2, juce::dontSendNotification);
+
+            if (RealtimeSafety::isEnabled())
+                startTimerHz(10);
+
             // Make sure that before the constructor has finished, you've set the
             // editor's size to whatever you need it to be.
             setSize(800, 600);        
@@ -28,14 +53,89 @@ void WeirdEffectsAudioProcessorEditor::paint (juce::Graphics& g)
 {
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-    g.setColour (juce::Colours::white);
-    g.setFont (15.0f);
-    g.drawFittedText ("Audio Volume", 5, 0, getWidth(), 30, juce::Justification::verticallyCentred, 1);
 
+    if (overlayHeight > 0) {
+        g.setColour (overlayShowsViolation ? juce::Colours::red : juce::Colours::white);
+        g.setFont (15.0f);
+        g.drawFittedText (overlayText, 5, 0, getWidth() - 10, overlayHeight, juce::Justification::centredLeft, 1);
+    }
 }
 
 void WeirdEffectsAudioProcessorEditor::resized()
 {
     // This is generally where you'll want to lay out the positions of any
     // subcomponents in your editor..
+    auto bounds = getLocalBounds();
+    bounds.removeFromTop(overlayHeight);
+
+    auto toolbar = bounds.removeFromTop(toolbarHeight).reduced(4, 2);
+    morphPresetB.setBounds(toolbar.removeFromRight(130));
+    morphPresetA.setBounds(toolbar.removeFromRight(130).withTrimmedRight(4));
+    loadImpulseButton.setBounds(toolbar.removeFromLeft(100));
+    impulseLabel.setBounds(toolbar.withTrimmedLeft(6));
+
+    spectrumDisplay.setBounds(bounds.removeFromTop(spectrumHeight));
+    responseCurve.setBounds(spectrumDisplay.getBounds());
+
+    parameterEditor.setBounds(bounds);
+}
+
+void WeirdEffectsAudioProcessorEditor::timerCallback()
+{
+    auto& monitor = audioProcessor.getRealtimeMonitor();
+
+    //Drains every timing recorded since the last tick so the ring never fills up while we're open
+    for (int numRead; (numRead = monitor.popBlockTimings(timingScratch.data(), (int)timingScratch.size())) > 0;) {
+        for (int i = 0; i < numRead; ++i)
+            recentPeakLoad = juce::jmax(recentPeakLoad, timingScratch[(size_t)i].load);
+
+        latestTiming = timingScratch[(size_t)numRead - 1];
+    }
+
+    auto totals = monitor.getTotals();
+    overlayShowsViolation = totals.blocksWithViolations > 0;
+
+    overlayText.clear();
+    overlayText << "Audio thread: " << (juce::int64)totals.allocations << " allocs, "
+                << (juce::int64)totals.deallocations << " frees, "
+                << (juce::int64)totals.locks << " locks in "
+                << (juce::int64)totals.blocks << " blocks | last "
+                << juce::String(latestTiming.microseconds, 1) << "us ("
+                << juce::String(latestTiming.load * 100.f, 1) << "%), peak "
+                << juce::String(recentPeakLoad * 100.f, 1) << "%";
+
+    //Let the peak fall back slowly so a single spike stays visible for a few seconds
+    recentPeakLoad *= 0.95f;
+
+    repaint(0, 0, getWidth(), overlayHeight);
+}
+
+void WeirdEffectsAudioProcessorEditor::chooseImpulseResponse()
+{
+    impulseChooser = std::make_unique<juce::FileChooser>("Load an impulse response", juce::File(), "*.wav;*.aif;*.aiff;*.flac");
+
+    //Async so the host's message loop keeps running while the dialog is open
+    impulseChooser->launchAsync(juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles,
+        [this](const juce::FileChooser& chooser) {
+            auto file = chooser.getResult();
+            if (file == juce::File())
+                return;
+
+            if (!audioProcessor.loadImpulseResponse(file))
+                juce::AlertWindow::showMessageBoxAsync(juce::MessageBoxIconType::WarningIcon, "Load IR", "Couldn't read " + file.getFileName());
+
+            updateImpulseLabel();
+        });
+}
+
+void WeirdEffectsAudioProcessorEditor::updateImpulseLabel()
+{
+    auto path = audioProcessor.valueTree.state.getProperty(WeirdEffectsAudioProcessor::impulseResponseFileProperty).toString();
+    impulseLabel.setText(path.isEmpty() ? "Built-in impulse response" : juce::File(path).getFileName(), juce::dontSendNotification);
+}
+
+void WeirdEffectsAudioProcessorEditor::updateMorphPresets()
+{
+    //Both need a preset, otherwise the processor switches the morph off
+    audioProcessor.setMorphPresets(morphPresetA.getSelectedId() - 2, morphPresetB.getSelectedId() - 2);
 }
@@ -10,11 +10,14 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "SpectrumDisplay.h"
+#include "ResponseCurveDisplay.h"
 
 //==============================================================================
 /**
 */
-class WeirdEffectsAudioProcessorEditor  : public juce::AudioProcessorEditor
+class WeirdEffectsAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                           private juce::Timer
 {
 public:
     WeirdEffectsAudioProcessorEditor (WeirdEffectsAudioProcessor&);
@@ -25,9 +28,42 @@ public:
     void resized() override;
 
 private:
+    //Polls the realtime monitor and repaints the overlay
+    void timerCallback() override;
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     WeirdEffectsAudioProcessor& audioProcessor;
 
+    //Pre/post spectrum above the parameters, with the cut/gain response drawn over it
+    static constexpr int spectrumHeight = 220;
+    SpectrumDisplay spectrumDisplay;
+    ResponseCurveDisplay responseCurve;
+
+    //Sliders/dropdowns for every parameter until the plugin has its own controls
+    juce::GenericAudioProcessorEditor parameterEditor;
+
+    //Picks the impulse response used by the convolution reverb mode
+    static constexpr int toolbarHeight = 28;
+    juce::TextButton loadImpulseButton{ "Load IR..." };
+    juce::Label impulseLabel;
+    std::unique_ptr<juce::FileChooser> impulseChooser;
+
+    void chooseImpulseResponse();
+    void updateImpulseLabel();
+
+    //The two presets the "Morph" parameter blends between, "Morph off" disables it
+    juce::ComboBox morphPresetA, morphPresetB;
+
+    void updateMorphPresets();
+
+    //Realtime safety overlay, only shown when built with WEIRDEFFECTS_REALTIME_CHECKS=1
+    static constexpr int overlayHeight = RealtimeSafety::isEnabled() ? 24 : 0;
+    std::array<RealtimeSafety::BlockTiming, 256> timingScratch;
+    RealtimeSafety::BlockTiming latestTiming;
+    float recentPeakLoad{ 0 };
+    juce::String overlayText;
+    bool overlayShowsViolation{ false };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WeirdEffectsAudioProcessorEditor)
 };
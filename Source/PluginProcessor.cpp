@@ -27,6 +27,8 @@ WeirdEffectsAudioProcessor::WeirdEffectsAudioProcessor()
 
 WeirdEffectsAudioProcessor::~WeirdEffectsAudioProcessor()
 {
+    //The chains it touches are gone before the Timer base class stops it
+    stopTimer();
 }
 
 //==============================================================================
@@ -64,93 +66,221 @@ bool WeirdEffectsAudioProcessor::isMidiEffect() const
 
 double WeirdEffectsAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    //Only reads atomics, so this is also fine from processBlock
+    auto settings = parameters.getSettings();
+
+    //The cuts ring for a few periods of the lowest corner
+    auto tail = 3.0 / juce::jmax(20.f, juce::jmin(settings.lowCutFreq, settings.highCutFreq));
+
+    //Reverb at 0 is fully dry, otherwise its decay (to -60dB) or the impulse response length
+    if (settings.reverb > 0.f) {
+        if (settings.reverbMode == ReverbMode::ReverbMode_Convolution)
+            tail += getActiveConvolution().getImpulseLengthSeconds();
+        else
+            tail += ReverbProcessor<float>::parametersFromAmount(settings.reverb).decaySeconds;
+    }
+
+    if (getSampleRate() > 0.0)
+        tail += currentLatency.load(std::memory_order_relaxed) / getSampleRate();
+
+    return tail;
 }
 
 int WeirdEffectsAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return PresetBank::getNumPresets();   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                                          // so this should be at least 1, even if you're not really implementing programs.
 }
 
 int WeirdEffectsAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentProgram;
 }
 
 void WeirdEffectsAudioProcessor::setCurrentProgram (int index)
 {
+    if (index < 0 || index >= PresetBank::getNumPresets())
+        return;
+
+    currentProgram = index;
+    auto& settings = PresetBank::getPreset(index).settings;
+
+    //Goes through the parameters so the host and the editor see the recalled values too
+    auto set = [this](ChainParameter id, float value) {
+        auto& parameter = parameters.getParameter(id);
+        parameter.setValueNotifyingHost(parameter.convertTo0to1(value));
+    };
+
+    set(GainParameter, settings.gain);
+    set(DryWetParameter, settings.dryWet);
+    set(ReverbParameter, settings.reverb);
+    set(LowCutFreqParameter, settings.lowCutFreq);
+    set(HighCutFreqParameter, settings.highCutFreq);
+    set(LowCutSlopeParameter, (float)settings.lowCutSlope);
+    set(HighCutSlopeParameter, (float)settings.highCutSlope);
+    set(ReverbModeParameter, (float)settings.reverbMode);
+    set(CutModeParameter, (float)settings.cutMode);
+    set(ModRateParameter, settings.modRate);
+    set(ModDepthParameter, settings.modDepth);
+    set(ModEnvelopeParameter, settings.modEnvelope);
+    set(ShapeParameter, (float)settings.shape);
+    set(DriveParameter, settings.drive);
+    set(CrushRateParameter, settings.crushRate);
+    set(CrushBitsParameter, settings.crushBits);
 }
 
 const juce::String WeirdEffectsAudioProcessor::getProgramName (int index)
 {
-    return {};
+    if (index < 0 || index >= PresetBank::getNumPresets())
+        return {};
+
+    return PresetBank::getPreset(index).name;
 }
 
 void WeirdEffectsAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    //Factory presets keep their names
 }
 
-//==============================================================================
-void WeirdEffectsAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+void WeirdEffectsAudioProcessor::setMorphPresets(int presetA, int presetB)
 {
-    // Use this method as the place to do any pre-playback 
-    // initialisation that you need..
+    auto valid = [](int index) { return index >= 0 && index < PresetBank::getNumPresets(); };
+    if (!valid(presetA) || !valid(presetB))
+        presetA = presetB = -1;
+
+    morphPresetA = presetA;
+    morphPresetB = presetB;
+
+    //Copies the settings in, so the audio thread never has to look anything up
+    auto& pair = morphPresets.getWriteBuffer();
+    pair.presetA = presetA;
+    pair.presetB = presetB;
+    if (pair.isEnabled()) {
+        pair.a = PresetBank::getPreset(presetA).settings;
+        pair.b = PresetBank::getPreset(presetB).settings;
+    }
+    morphPresets.publish();
+}
 
-    //Prepares ProcessChains using prepare(), must be done before playing
-    juce::dsp::ProcessSpec spec; 
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = 1;
-    spec.sampleRate = sampleRate;
+ChainSettings WeirdEffectsAudioProcessor::getEffectiveSettings() const noexcept
+{
+    auto& pair = morphPresets.getReadBuffer();
+    if (!pair.isEnabled())
+        return parameters.getSettings();
 
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
+    auto settings = PresetBank::interpolate(pair.a, pair.b, parameters.get(MorphParameter) / 100.f);
 
-    auto chainSettings = getChainSettings(valueTree);
+    //Linear phase changes the latency, so a morph sweep must never switch it on or off. Whether
+    //it's on comes from the parameter alone, the morph only picks between the other two modes.
+    auto parameterCutMode = static_cast<CutMode>(static_cast<int>(parameters.get(CutModeParameter)));
+    if (parameterCutMode == CutMode::CutMode_LinearPhase || settings.cutMode == CutMode::CutMode_LinearPhase)
+        settings.cutMode = parameterCutMode;
 
-    //IIR::Coefficients are reference-counted wrappers with a juce::Array that allocate on the heap.
-    //From what I understand, it works similar to a smart pointer. From what I see online, allocating
-    //on the heap is no good, but I have no choice.
-    
-    auto lowCutCoefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, 20.f, .8f);
-    auto highCutCoefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, 19000.f, .8f);
-
-    //auto gainCoefficient = juce::dsp::DryWetMixer<float>::DryWetMixer(samplesPerBlock);
-    //auto reverbCoefficient = juce::dsp::Reverb::
-
-    /*
-    *leftChain.get<ChainPosition::LowCut>().coefficients = *lowCutCoefficients;
-    *rightChain.get<ChainPosition::LowCut>().coefficients = *lowCutCoefficients;
-    *leftChain.get<ChainPosition::HighCut>().coefficients = *highCutCoefficients;
-    *rightChain.get<ChainPosition::HighCut>().coefficients = *highCutCoefficients;
-    * */
-
-    /*
- for (int i = 0; i < order / 2; ++i)
-     {
-         auto Q = 1.0 / (2.0 * std::cos ((2.0 * i + 1.0) * MathConstants<double>::pi / (order * 2.0)));
-         arrayFilters.add (*IIR::Coefficients<FloatType>::makeHighPass (sampleRate, frequency,
-                                                                        static_cast<FloatType> (Q)));
-     }
-     This is the algorithm used to calculate how many Coefficient objects we create based on order.
-     So, if we want 3 different slope choices, we need order of 6 becuase 6/2=3
- */
-    auto cutCoefficients = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod
-    (chainSettings.lowCutFreq, getSampleRate(), 2*(chainSettings.lowCutSlope + 1));
+    return settings;
+}
 
-    auto& leftLowCut = leftChain.get<ChainPosition::LowCut>();
-    auto& rightLowCut = rightChain.get<ChainPosition::LowCut>();
+//==============================================================================
+void WeirdEffectsAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    // Use this method as the place to do any pre-playback 
+    // initialisation that you need..
 
-    setBypassLeftRightFilter(leftLowCut, rightLowCut, true);
-    setFilterCoefficients(leftLowCut, cutCoefficients[0], chainSettings.lowCutSlope);
+    //Prepares the cut filters and the ProcessChain using prepare(), must be done before playing.
+    //Everything processes all channels at once now instead of one MonoChain per side.
+    //Fixed blocks for "Block Mode" Fixed, and the longest run processChunk is ever given
+    fixedBlockSize = juce::jlimit(32, 512, juce::nextPowerOfTwo((int)std::ceil(sampleRate * 0.002)));
+    maxChunkSize = juce::jmax(samplesPerBlock, fixedBlockSize);
 
+    juce::dsp::ProcessSpec spec;
+    spec.maximumBlockSize = (juce::uint32)maxChunkSize;
+    spec.numChannels = getTotalNumOutputChannels();
+    spec.sampleRate = sampleRate;
 
+    realtimeMonitor.prepare(sampleRate);
+    spectrumAnalyzer.prepare(sampleRate);
+    cutModulator.prepare(sampleRate, maxChunkSize);
+
+    //The host has already picked the precision, only that chain gets its memory
+    coefficientService.prepare(sampleRate);
+    if (isUsingDoublePrecision())
+        prepareChain<double>(spec);
+    else
+        prepareChain<float>(spec);
+
+    //Start awake, the states were just reset
+    silentSamples = 0;
+    sleeping = false;
+    samplesSinceParameterPoll = 0;
+    samplesSinceCoefficientUpdate = 0;
+
+    //Reports latency changes from the audio thread to the host, picks up the FDN memory requests
+    //of stages pruned or brought back while playing, and builds the waveshaper's oversampler
+    startTimerHz(20);
+}
+
+template <typename SampleType>
+void WeirdEffectsAudioProcessor::prepareChain(const juce::dsp::ProcessSpec& spec)
+{
+    auto& chain = getChain<SampleType>();
+
+    //Offline renders run the convolution tail inline so the result never depends on thread timing
+    chain.effectChain.template get<ChainPosition::Convolution>().setUseBackgroundTail(!isNonRealtime());
+
+    //The FDN only gets its delay memory up front if it's going to run. Offline it always does,
+    //there may be no message thread to hand it over later and renders must not depend on timing.
+    morphPresets.update();
+    auto settings = getEffectiveSettings();
+    chain.effectChain.template get<ChainPosition::Reverb>().setMemoryWanted(isNonRealtime()
+        || (settings.reverb > 0.f && settings.reverbMode == ReverbMode::ReverbMode_Algorithmic));
+
+    //The shaper builds the oversampler it's asked for here in prepare, later changes come from the
+    //timer, or from process() itself offline
+    auto& shaper = chain.effectChain.template get<ChainPosition::Shaper>();
+    shaper.setBuildInline(isNonRealtime());
+    shaper.setOversampling(static_cast<OversamplingFactor>(static_cast<int>(parameters.get(OversamplingParameter))),
+                           static_cast<OversamplingQuality>(static_cast<int>(parameters.get(OversamplingQualityParameter))));
+
+    chain.cutFilters.prepare(spec);
+    chain.modulatedCutFilters.prepare(spec);
+    chain.linearPhaseCutFilters.prepare(spec);
+    chain.cutFadeIn.prepare(spec, 0.05);
+    chain.fifo.setSize((int)spec.numChannels, fixedBlockSize);
+    chain.fifo.clear();
+    fifoPosition = 0;
+    chain.effectChain.prepare(spec);
+    chain.dryWet.prepare(spec);
+    chain.dryWet.setMixingRule(juce::dsp::DryWetMixingRule::sin3dB);
+    chain.effectChain.template get<ChainPosition::Gain>().setRampDurationSeconds(0.05);
+
+    //Everything counts as changed after a prepare so every stage starts from the current settings,
+    //and every stage starts in the chain until updatePruning finds it neutral
+    parameterReader.markAllChanged();
+    prunedStages = {};
+    updateStages<SampleType>(parameterReader.pollChanges(parameters), settings);
+    updateLatency<SampleType>();
+    reportLatency();
+
+    //The host has just been given the latency, so a new block mode can start right away
+    blockMode = requestedBlockMode;
+
+    //The service jumped straight to the current cut settings in prepare(), no glide from stale values
+    chain.cutFilters.setCoefficients(coefficientService.getCurrent().lowCut, coefficientService.getCurrent().highCut);
+    chain.modulatedCutFilters.snapToTargets();
+
+    //Designed right here so playback doesn't start by waiting for the designer thread
+    if (activeCutMode == CutMode::CutMode_LinearPhase)
+        chain.linearPhaseCutFilters.snapToTargets();
 }
 
 void WeirdEffectsAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    stopTimer();
+    floatChain.effectChain.get<ChainPosition::Convolution>().release();
+    doubleChain.effectChain.get<ChainPosition::Convolution>().release();
+    floatChain.linearPhaseCutFilters.release();
+    doubleChain.linearPhaseCutFilters.release();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -161,11 +291,10 @@ bool WeirdEffectsAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
     return true;
   #else
     // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every stage works on any number of channels (cuts in SIMD lane groups, one shared
+    // reverb tank), so anything from mono up to 7th order ambisonics is fine.
+    auto numChannels = layouts.getMainOutputChannelSet().size();
+    if (layouts.getMainOutputChannelSet().isDisabled() || numChannels > maxChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -180,9 +309,24 @@ bool WeirdEffectsAudioProcessor::isBusesLayoutSupported (const BusesLayout& layo
 #endif
 
 void WeirdEffectsAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer);
+}
+
+void WeirdEffectsAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples(buffer);
+}
+
+template <typename SampleType>
+void WeirdEffectsAudioProcessor::processSamples (juce::AudioBuffer<SampleType>& buffer)
 {
     //This Code handles the Audio Buffer
     juce::ScopedNoDenormals noDenormals;
+
+    //Counts allocations/locks and times the block when the realtime checks are compiled in
+    RealtimeSafety::ScopedAudioCallback realtimeScope(realtimeMonitor, buffer.getNumSamples());
+    auto numSamples = buffer.getNumSamples();
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
     // In case we have more outputs than inputs, this code clears any output
@@ -195,50 +339,207 @@ void WeirdEffectsAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
         buffer.clear (i, 0, buffer.getNumSamples());
 
     //Processor Chains require a dsp::ProcessContext to run audio through links in chains
-//ProcessContext requires dsp::AudioBlock
-//AudioBlock requires dsp::AudioBuffer
-    juce::dsp::AudioBlock<float> block(buffer);
+    //ProcessContext requires dsp::AudioBlock
+    //AudioBlock requires dsp::AudioBuffer
+    juce::dsp::AudioBlock<SampleType> block(buffer);
+
+    //A new block mode waits until reportLatency has told the host the latency it comes with.
+    //Starting the FIFO again means its first block out is silent, like after prepareToPlay.
+    if (requestedBlockMode != blockMode
+        && (int)(reportedLatencyVersion.load(std::memory_order_acquire) - blockModeLatencyVersion) >= 0) {
+        blockMode = requestedBlockMode;
+        getChain<SampleType>().fifo.clear();
+        fifoPosition = 0;
+    }
 
-    //Creates audio blocks for each channel for stereo
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    //"Block Mode" Fixed: everything goes through the FIFO and the chain only ever sees
+    //fixedBlockSize samples at a time, whatever the host sends
+    if (blockMode == BlockMode::BlockMode_Fixed) {
+        processFixedBlocks(block);
+        return;
+    }
 
-    //Use ProcessContextReplacing instead of NonReplacing because it handles one channel each, left and right
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    //Zero latency. Tiny blocks share the control rate work between them instead of each paying
+    //for it, anything longer than the chain was prepared for is cut into blocks that fit.
+    if (numSamples < CoefficientService::subBlockSize) {
+        samplesSinceParameterPoll += numSamples;
+        auto pollNow = samplesSinceParameterPoll >= CoefficientService::subBlockSize;
+        if (pollNow)
+            samplesSinceParameterPoll = 0;
 
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+        processChunk(block, pollNow);
+        return;
+    }
 
-    
-    auto chainSettings = getChainSettings(valueTree);
-    auto lowCutCoefficients = juce::dsp::IIR::Coefficients<float>::makeHighPass(getSampleRate(), 20.f, .8f);
-    auto highCutCoefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass(getSampleRate(), 20000.f, .8f);
-    /*
-    *leftChain.get<ChainPosition::LowCut>().coefficients = *lowCutCoefficients;
-    *rightChain.get<ChainPosition::LowCut>().coefficients = *lowCutCoefficients;
-    *leftChain.get<ChainPosition::HighCut>().coefficients = *highCutCoefficients;
-    *rightChain.get<ChainPosition::HighCut>().coefficients = *highCutCoefficients;
-     */
+    samplesSinceParameterPoll = 0;
+    for (int start = 0; start < numSamples; start += maxChunkSize)
+        processChunk(block.getSubBlock((size_t)start, (size_t)juce::jmin(maxChunkSize, numSamples - start)), true);
+}
 
-    //Processor Chains require a dsp::ProcessContext to run audio through links in chains
-//ProcessContext requires dsp::AudioBlock
-//AudioBlock requires dsp::AudioBuffer
-    juce::dsp::AudioBlock<float> block(buffer);
+template <typename SampleType>
+void WeirdEffectsAudioProcessor::processFixedBlocks(juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    auto& fifo = getChain<SampleType>().fifo;
+    auto channels = juce::jmin((int)block.getNumChannels(), fifo.getNumChannels());
+    auto numSamples = (int)block.getNumSamples();
+
+    for (int offset = 0; offset < numSamples;) {
+        auto count = juce::jmin(numSamples - offset, fixedBlockSize - fifoPosition);
+
+        //The FIFO holds the last processed block until it has been played out, and each played
+        //sample's slot takes the input sample that replaces it, so one swap does both directions
+        for (int c = 0; c < channels; ++c) {
+            auto* samples = block.getChannelPointer((size_t)c) + offset;
+            std::swap_ranges(samples, samples + count, fifo.getWritePointer(c, fifoPosition));
+        }
+
+        fifoPosition += count;
+        offset += count;
+
+        if (fifoPosition == fixedBlockSize) {
+            processChunk(juce::dsp::AudioBlock<SampleType>(fifo), true);
+            fifoPosition = 0;
+        }
+    }
+}
+
+template <typename SampleType>
+void WeirdEffectsAudioProcessor::processChunk(juce::dsp::AudioBlock<SampleType> block, bool pollParameters)
+{
+    auto& chain = getChain<SampleType>();
+    auto numSamples = (int)block.getNumSamples();
+    auto totalNumInputChannels  = getTotalNumInputChannels();
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
 
-    //Creates audio blocks for each channel for stereo
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
+    spectrumAnalyzer.push(SpectrumAnalyzer::Pre, block, totalNumInputChannels);
+
+    //Only touches the stages whose parameters moved, most blocks this is one atomic compare.
+    //While morphing, a new preset pair or a move of "Morph" can change any stage.
+    if (pollParameters) {
+        auto changes = parameterReader.pollChanges(parameters);
+        if (morphPresets.update())
+            changes |= ParameterSnapshot::allMask;
+        if ((changes & ParameterSnapshot::morphMask) != 0 && morphPresets.getReadBuffer().isEnabled())
+            changes |= ParameterSnapshot::allMask;
+
+        if (changes)
+            updateStages<SampleType>(changes, getEffectiveSettings());
+        else if (pruningPending)
+            updatePruning<SampleType>();
+    }
 
-    //Use ProcessContextReplacing instead of NonReplacing because it handles one channel each, left and right
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+    //Asleep and still silent: the output would be silent too, so skip everything. Parameters
+    //and coefficients above are still picked up, so waking up starts from the current settings.
+    if (isSilent(block, totalNumInputChannels)) {
+        silentSamples += numSamples;
+
+        if (sleeping) {
+            //Keep the cut glides moving so they don't resume from a stale frequency on wake up
+            if (coefficientService.isChanging()) {
+                auto& cuts = coefficientService.advance(numSamples);
+                chain.cutFilters.setCoefficients(cuts.lowCut, cuts.highCut);
+            }
+
+            block.clear();
+            sleptBlocks.fetch_add(1, std::memory_order_relaxed);
+
+            //Still fed while asleep, so an open analyser falls back to the floor instead of freezing
+            spectrumAnalyzer.push(SpectrumAnalyzer::Post, block, totalNumOutputChannels);
+            return;
+        }
+    }
+    else {
+        //The whole block gets processed, the silent start of it just runs through quiet states
+        silentSamples = 0;
+        sleeping = false;
+    }
 
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
+    juce::dsp::ProcessContextReplacing<SampleType> context(block);
+
+    //Copies the input into the mixer's preallocated dry buffer before it gets processed in place
+    chain.dryWet.pushDrySamples(block);
+
+    //Pruned cuts are skipped entirely. Gain, the shaper and the reverbs are bypassed inside the chain instead.
+    if (!prunedStages.cuts) {
+        //The LFO/envelope offsets have to come from the input, before anything touches it.
+        //A linear phase kernel can't follow them, so that mode ignores the modulation.
+        auto modulated = cutModulator.isActive() && activeCutMode != CutMode::CutMode_LinearPhase;
+        if (modulated)
+            cutModulator.process(block);
+        auto* octaveOffsets = modulated ? cutModulator.getOffsets() : nullptr;
+
+        chain.cutFadeIn.pushInput(block);
+
+        //Every channel goes through the cuts in one pass, then gain and whichever reverb is active.
+        //While a cut frequency glides or is modulated the Butterworth cuts run in short sub-blocks
+        //with fresh coefficients for each, so automation sweeps smoothly instead of stepping once
+        //per host block. The state variable cuts take a new cutoff every sample instead, and the
+        //linear phase cuts crossfade to a new kernel once the designer thread has built it.
+        if (activeCutMode == CutMode::CutMode_LinearPhase) {
+            chain.linearPhaseCutFilters.process(context);
+        }
+        else if (activeCutMode == CutMode::CutMode_StateVariable) {
+            chain.modulatedCutFilters.process(context, octaveOffsets);
+        }
+        else if (coefficientService.isChanging() || modulated) {
+            if (numSamples < CoefficientService::subBlockSize) {
+                //Blocks shorter than a sub-block only look up new coefficients once enough of them
+                //have gone by, so the cuts move at the same rate whatever the host's block size
+                samplesSinceCoefficientUpdate += numSamples;
+                if (samplesSinceCoefficientUpdate >= CoefficientService::subBlockSize) {
+                    auto& cuts = coefficientService.advance(samplesSinceCoefficientUpdate, modulated ? octaveOffsets[0] : 0.f);
+                    chain.cutFilters.setCoefficients(cuts.lowCut, cuts.highCut);
+                    samplesSinceCoefficientUpdate = 0;
+                }
+
+                chain.cutFilters.process(context);
+            }
+            else {
+                samplesSinceCoefficientUpdate = 0;
+
+                for (int start = 0; start < numSamples; start += CoefficientService::subBlockSize) {
+                    auto length = juce::jmin(CoefficientService::subBlockSize, numSamples - start);
+                    auto& cuts = coefficientService.advance(length, modulated ? octaveOffsets[start] : 0.f);
+                    chain.cutFilters.setCoefficients(cuts.lowCut, cuts.highCut);
+
+                    auto subBlock = block.getSubBlock((size_t)start, (size_t)length);
+                    chain.cutFilters.process(juce::dsp::ProcessContextReplacing<SampleType>(subBlock));
+                }
+            }
+        }
+        else {
+            chain.cutFilters.process(context);
+        }
+
+        chain.cutFadeIn.mixOutput(block);
+    }
+    chain.effectChain.process(context);
 
-    
-   
+    //The shaper swapped in an oversampler for a new setting, which moves the latency
+    if (chain.effectChain.template get<ChainPosition::Shaper>().getLatencySamples() != shaperLatency)
+        updateLatency<SampleType>();
+
+    //Equal power blend with the (latency aligned) dry signal, smoothed per sample
+    chain.dryWet.mixWetSamples(block);
+
+    spectrumAnalyzer.push(SpectrumAnalyzer::Post, block, totalNumOutputChannels);
+
+    //Only worth scanning the output once the input has been quiet for the whole tail
+    if (silentSamples > (juce::int64)(getTailLengthSeconds() * getSampleRate()) && isSilent(block, totalNumOutputChannels))
+        sleeping = true;
+}
+
+template <typename SampleType>
+bool WeirdEffectsAudioProcessor::isSilent(const juce::dsp::AudioBlock<SampleType>& block, int numChannels) noexcept
+{
+    //findMinAndMax is vectorised, so this is one pass per channel
+    for (int c = 0; c < juce::jmin(numChannels, (int)block.getNumChannels()); ++c) {
+        auto range = juce::FloatVectorOperations::findMinAndMax(block.getChannelPointer((size_t)c), (int)block.getNumSamples());
+        if (juce::jmax(-range.getStart(), range.getEnd()) > static_cast<SampleType>(silenceThreshold))
+            return false;
+    }
+
+    return true;
 }
 
 //==============================================================================
@@ -250,21 +551,75 @@ bool WeirdEffectsAudioProcessor::hasEditor() const
 juce::AudioProcessorEditor * WeirdEffectsAudioProcessor::createEditor()
 {
 
-    return new juce::GenericAudioProcessorEditor(*this);
+    return new WeirdEffectsAudioProcessorEditor(*this);
 }
 
 //==============================================================================
 void WeirdEffectsAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
+    //Compact binary, see PluginState.h. Hosts call this for every instance when saving a session.
+    PluginState::writeBinary(captureState(), destData);
 }
 
 void WeirdEffectsAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
+    //Fields the data doesn't have keep their current values
+    auto state = captureState();
+
+    if (PluginState::readBinary(data, sizeInBytes, state)) {
+        applyState(state);
+        return;
+    }
+
+    //Not ours in binary, so XML from copyXmlToBinary (interchange, or another tool)
+    if (auto xml = getXmlFromBinary(data, sizeInBytes))
+        loadStateXml(*xml);
+}
+
+std::unique_ptr<juce::XmlElement> WeirdEffectsAudioProcessor::createStateXml()
+{
+    return PluginState::createXml(captureState(), valueTree.state.getType());
+}
+
+void WeirdEffectsAudioProcessor::loadStateXml(const juce::XmlElement& xml)
+{
+    auto state = captureState();
+    if (PluginState::readXml(xml, state))
+        applyState(state);
+}
+
+PluginStateData WeirdEffectsAudioProcessor::captureState() const
+{
+    PluginStateData state;
+
+    for (int i = 0; i < NumChainParameters; ++i)
+        state.values[(size_t)i] = parameters.get(static_cast<ChainParameter>(i));
+
+    state.program = currentProgram;
+    state.morphPresetA = morphPresetA;
+    state.morphPresetB = morphPresetB;
+    state.impulseResponseFile = valueTree.state.getProperty(impulseResponseFileProperty).toString();
+    return state;
+}
+
+void WeirdEffectsAudioProcessor::applyState(const PluginStateData& state)
+{
+    //Setting a parameter only stores a number, the audio thread picks the new values up at the
+    //next block and looks its coefficients up in the shared table, nothing gets designed here
+    for (int i = 0; i < NumChainParameters; ++i) {
+        auto& parameter = parameters.getParameter(static_cast<ChainParameter>(i));
+        parameter.setValueNotifyingHost(parameter.convertTo0to1(state.values[(size_t)i]));
+    }
+
+    currentProgram = juce::jlimit(0, PresetBank::getNumPresets() - 1, state.program);
+    setMorphPresets(state.morphPresetA, state.morphPresetB);
+
+    //Only reload the impulse response if it's a different file, it gets resampled and partitioned
+    auto currentFile = valueTree.state.getProperty(impulseResponseFileProperty).toString();
+    if (state.impulseResponseFile.isNotEmpty() && state.impulseResponseFile != currentFile) {
+        if (!loadImpulseResponse(juce::File(state.impulseResponseFile)))
+            valueTree.state.setProperty(impulseResponseFileProperty, state.impulseResponseFile, nullptr);
+    }
 }
 
  juce::AudioProcessorValueTreeState::ParameterLayout WeirdEffectsAudioProcessor::createParameterLayout()
@@ -277,11 +632,12 @@ void WeirdEffectsAudioProcessor::setStateInformation (const void* data, int size
          juce::String("Gain"), 
          juce::NormalisableRange<float>(-32.f, 6.f, .5f, 1.f), 0.f));
 
-    //Creates Audio Parameter for dry/wet of entire effect. 0 being 0%, 100 being 100%, 50 being 50%, the default
+    //Creates Audio Parameter for dry/wet of entire effect. 0 being 0%, 100 being 100%, the default.
+    //Not 50: at the defaults the wet path is the dry signal, and the equal power law would sum the two 3dB hot.
     layout.add(std::make_unique<juce::AudioParameterFloat>
         (juce::ParameterID("Dry/Wet"),
          juce::String("Dry/Wet"), 
-         juce::NormalisableRange<float>(0.f, 100.f, 1.f, 1.f), 50.f));
+         juce::NormalisableRange<float>(0.f, 100.f, 1.f, 1.f), 100.f));
     
 
     //Creates Audio Parameter for controlling amount of reverb.
@@ -295,13 +651,13 @@ void WeirdEffectsAudioProcessor::setStateInformation (const void* data, int size
     layout.add(std::make_unique<juce::AudioParameterFloat>
         (juce::ParameterID("LowCut Freq"),
          juce::String("LowCut Freq"),
-         juce::NormalisableRange<float>(20.f, 20000.f,1.f, 1.f), 20.f));
+         juce::NormalisableRange<float>(minCutFrequency, maxCutFrequency, 1.f, 1.f), minCutFrequency));
 
     //Creates HighCut frequency parameter for cutting out high end
     layout.add(std::make_unique<juce::AudioParameterFloat>
         (juce::ParameterID("HighCut Freq"),
          juce::String("HighCut Freq"),
-         juce::NormalisableRange<float>(20.f, 20000.f, 1.f, 1.f), 20000.f));
+         juce::NormalisableRange<float>(minCutFrequency, maxCutFrequency, 1.f, 1.f), maxCutFrequency));
 
     //Creates a selection of different slope steepness for the EQ cut-off. Range from 12db-36db
     juce::StringArray dbOctSlopeArr;
@@ -318,58 +674,347 @@ void WeirdEffectsAudioProcessor::setStateInformation (const void* data, int size
     layout.add(std::make_unique<juce::AudioParameterChoice>
         ("High-Cut Slope", "High-Cut Slope", dbOctSlopeArr, 0));
 
+    //Picks which reverb "Reverb" drives, the feedback delay network or the impulse response
+    layout.add(std::make_unique<juce::AudioParameterChoice>
+        ("Reverb Mode", "Reverb Mode", juce::StringArray{ "Algorithmic", "Convolution" }, 0));
+
+    //Blend between the two morph presets, 0 being all A and 100 all B. Does nothing until
+    //setMorphPresets picks them.
+    layout.add(std::make_unique<juce::AudioParameterFloat>
+        (juce::ParameterID("Morph"),
+         juce::String("Morph"),
+         juce::NormalisableRange<float>(0.f, 100.f, 0.1f, 1.f), 0.f));
+
+    //Butterworth biquads, state variable filters that can follow the modulation every sample, or
+    //a linear phase FIR with the same magnitude response (adds latency, ignores the modulation).
+    //Not automatable because of that latency, like Block Mode. The FIR runs on juce::dsp::FFT,
+    //which is float only, so in a double precision host Linear Phase is float accurate (about
+    //-140dB of rounding noise) while the other two modes keep full double precision.
+    layout.add(std::make_unique<juce::AudioParameterChoice>
+        (juce::ParameterID("Cut Mode"),
+         juce::String("Cut Mode"),
+         juce::StringArray{ "Butterworth", "State Variable", "Linear Phase" }, 0,
+         juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+
+    //LFO moving both cut frequencies, from slow sweeps up to audio rate. Skewed so the slow end gets most of the range.
+    layout.add(std::make_unique<juce::AudioParameterFloat>
+        (juce::ParameterID("Mod Rate"),
+         juce::String("Mod Rate"),
+         juce::NormalisableRange<float>(0.05f, 500.f, 0.01f, 0.25f), 1.f));
+
+    //How far the LFO moves the cuts, in octaves either way
+    layout.add(std::make_unique<juce::AudioParameterFloat>
+        (juce::ParameterID("Mod Depth"),
+         juce::String("Mod Depth"),
+         juce::NormalisableRange<float>(0.f, 4.f, 0.01f, 1.f), 0.f));
+
+    //How far a full scale input pushes the cuts up (or down when negative), in octaves
+    layout.add(std::make_unique<juce::AudioParameterFloat>
+        (juce::ParameterID("Mod Envelope"),
+         juce::String("Mod Envelope"),
+         juce::NormalisableRange<float>(-4.f, 4.f, 0.01f, 1.f), 0.f));
+
+    //Fixed re-blocks tiny or irregular host buffers into about 2ms blocks, adding that much latency.
+    //Not automatable, a host can't follow latency changing in the middle of playback.
+    layout.add(std::make_unique<juce::AudioParameterChoice>
+        (juce::ParameterID("Block Mode"),
+         juce::String("Block Mode"),
+         juce::StringArray{ "Zero Latency", "Fixed" }, 0,
+         juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+
+    //How hard the signal hits the waveshaper curve, on top of Gain. Does nothing while Shape is Off.
+    layout.add(std::make_unique<juce::AudioParameterFloat>
+        (juce::ParameterID("Drive"),
+         juce::String("Drive"),
+         juce::NormalisableRange<float>(0.f, 36.f, 0.1f, 1.f), 0.f));
+
+    //Waveshaper curve: soft saturation, folding back past full scale, or saturating each half differently
+    layout.add(std::make_unique<juce::AudioParameterChoice>
+        (juce::ParameterID("Shape"),
+         juce::String("Shape"),
+         juce::StringArray{ "Off", "Tanh", "Foldback", "Asymmetric" }, 0));
+
+    //Sample rate reduction: every sample is held for this many samples, 1 being off. Skewed so the subtle end gets most of the range.
+    layout.add(std::make_unique<juce::AudioParameterFloat>
+        (juce::ParameterID("Crush Rate"),
+         juce::String("Crush Rate"),
+         juce::NormalisableRange<float>(1.f, 64.f, 0.01f, 0.3f), 1.f));
+
+    //Bit reduction, 24 being off
+    layout.add(std::make_unique<juce::AudioParameterFloat>
+        (juce::ParameterID("Crush Bits"),
+         juce::String("Crush Bits"),
+         juce::NormalisableRange<float>(2.f, 24.f, 0.1f, 1.f), 24.f));
+
+    //Runs the waveshaper and crusher at a multiple of the sample rate so less of what they add
+    //aliases. Adds latency, so like Block Mode it isn't automatable.
+    layout.add(std::make_unique<juce::AudioParameterChoice>
+        (juce::ParameterID("Oversampling"),
+         juce::String("Oversampling"),
+         juce::StringArray{ "Off", "2x", "4x", "8x" }, 0,
+         juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+
+    //Polyphase IIR half bands (least latency), the same with steeper filters, or linear phase FIRs (most latency)
+    layout.add(std::make_unique<juce::AudioParameterChoice>
+        (juce::ParameterID("Oversampling Quality"),
+         juce::String("Oversampling Quality"),
+         juce::StringArray{ "Low Latency", "Balanced", "Linear Phase" }, 0,
+         juce::AudioParameterChoiceAttributes().withAutomatable(false)));
+
     return layout;
     
 }
 
- ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& tree) {
+ template <typename SampleType>
+ void WeirdEffectsAudioProcessor::updateStages(juce::uint32 changes, const ChainSettings& settings) {
+     auto& chain = getChain<SampleType>();
+
+     //LowCut/HighCut only set where the glide is heading, processSamples moves the filters there
+     if (changes & ParameterSnapshot::cutMask) {
+         coefficientService.setTargets(settings);
+         chain.modulatedCutFilters.setTargets(settings.lowCutFreq, (int)settings.lowCutSlope + 1,
+                                              settings.highCutFreq, (int)settings.highCutSlope + 1);
+
+         //Only asks the designer thread for a kernel when it's going to be used
+         if (settings.cutMode == CutMode::CutMode_LinearPhase)
+             chain.linearPhaseCutFilters.setTargets(settings.lowCutFreq, (int)settings.lowCutSlope + 1,
+                                                    settings.highCutFreq, (int)settings.highCutSlope + 1);
+
+         //The cascade switched in has stale state from whenever it last ran
+         if (settings.cutMode != activeCutMode) {
+             activeCutMode = settings.cutMode;
+             if (activeCutMode == CutMode::CutMode_LinearPhase)
+                 chain.linearPhaseCutFilters.reset();
+             else if (activeCutMode == CutMode::CutMode_StateVariable)
+                 chain.modulatedCutFilters.reset();
+             else
+                 chain.cutFilters.reset();
+
+             //Linear phase adds latency, the other two don't
+             updateLatency<SampleType>();
+         }
+     }
+
+     if (changes & ParameterSnapshot::modulationMask)
+         cutModulator.setParameters(settings.modRate, settings.modDepth, settings.modEnvelope);
+
+     //A 20Hz LowCut and 20kHz HighCut count as off. Linear phase never does, pruning it would
+     //change the latency.
+     if (changes & (ParameterSnapshot::cutMask | ParameterSnapshot::modulationMask))
+         neutralStages.cuts = activeCutMode != CutMode::CutMode_LinearPhase && !cutModulator.isActive()
+                           && settings.lowCutFreq <= minCutFrequency && settings.highCutFreq >= maxCutFrequency;
+
+     if (changes & ParameterSnapshot::gainMask) {
+         chain.effectChain.template get<ChainPosition::Gain>().setGainDecibels(static_cast<SampleType>(settings.gain));
+         neutralStages.gain = settings.gain == 0.f;
+     }
+
+     //Reverb is 0-100 and drives size, decay and mix of the FDN at once, or just the mix of the
+     //convolution. The inactive one is bypassed in updatePruning so it costs nothing.
+     if (changes & ParameterSnapshot::reverbMask) {
+         useConvolutionReverb = settings.reverbMode == ReverbMode::ReverbMode_Convolution;
+         neutralStages.reverb = settings.reverb == 0.f;
+
+         chain.effectChain.template get<ChainPosition::Reverb>().setParameters(ReverbProcessor<SampleType>::parametersFromAmount(settings.reverb));
+         chain.effectChain.template get<ChainPosition::Convolution>().setMix(settings.reverb / 100.f);
+     }
+
+     if (changes & ParameterSnapshot::shaperMask) {
+         typename ShaperProcessor<SampleType>::Parameters shaperParameters;
+         shaperParameters.shape = settings.shape;
+         shaperParameters.driveDecibels = settings.drive;
+         shaperParameters.crushRate = settings.crushRate;
+         shaperParameters.crushBits = settings.crushBits;
+
+         chain.effectChain.template get<ChainPosition::Shaper>().setParameters(shaperParameters);
+         neutralStages.shaper = ShaperProcessor<SampleType>::isNeutral(shaperParameters);
+     }
+
+     //Changes the latency like the block mode, so it never follows the morph either. The new
+     //oversampler gets built off the audio thread, processChunk reports the latency once it's in.
+     if (changes & ParameterSnapshot::oversamplingMask)
+         chain.effectChain.template get<ChainPosition::Shaper>().setOversampling(
+             static_cast<OversamplingFactor>(static_cast<int>(parameters.get(OversamplingParameter))),
+             static_cast<OversamplingQuality>(static_cast<int>(parameters.get(OversamplingQualityParameter))));
+
+     if (changes & ParameterSnapshot::dryWetMask)
+         chain.dryWet.setWetMixProportion(static_cast<SampleType>(settings.dryWet / 100.f));
+
+     //How the host's blocks get split up isn't part of a preset, so it never follows the morph.
+     //Only the latency is queued here, processSamples switches once the host has seen it.
+     if (changes & ParameterSnapshot::blockMask) {
+         auto newBlockMode = static_cast<BlockMode>(static_cast<int>(parameters.get(BlockModeParameter)));
+         if (newBlockMode != requestedBlockMode) {
+             requestedBlockMode = newBlockMode;
+             updateLatency<SampleType>();
+             blockModeLatencyVersion = pendingLatencyVersion.load(std::memory_order_relaxed);
+         }
+     }
+
+     updatePruning<SampleType>();
+ }
+
+ template <typename SampleType>
+ void WeirdEffectsAudioProcessor::updatePruning() noexcept {
+     auto& chain = getChain<SampleType>();
+     auto& gain = chain.effectChain.template get<ChainPosition::Gain>();
+     auto& shaper = chain.effectChain.template get<ChainPosition::Shaper>();
+     auto& reverb = chain.effectChain.template get<ChainPosition::Reverb>();
+     auto& convolution = chain.effectChain.template get<ChainPosition::Convolution>();
+
+     pruningPending = false;
+
+     //Only pruned once they've glided all the way there, or the end of the glide would be cut
+     //off. Brought back straight away, with state that's stale by then, so they fade in.
+     if (!neutralStages.cuts) {
+         if (prunedStages.cuts) {
+             prunedStages.cuts = false;
+             chain.cutFilters.reset();
+             chain.modulatedCutFilters.reset();
+             chain.linearPhaseCutFilters.reset();
+             chain.cutFadeIn.start();
+         }
+     }
+     else if (!prunedStages.cuts) {
+         auto gliding = activeCutMode == CutMode::CutMode_StateVariable ? chain.modulatedCutFilters.isGliding()
+                                                                        : coefficientService.isChanging();
+         prunedStages.cuts = !gliding;
+         pruningPending |= gliding;
+     }
+
+     //The gain ramps from unity whenever it comes back, so it needs no fade of its own
+     if (!neutralStages.gain) {
+         prunedStages.gain = false;
+     }
+     else if (!prunedStages.gain) {
+         prunedStages.gain = !gain.isSmoothing();
+         pruningPending |= gain.isSmoothing();
+     }
+
+     //The shaper glides from its (delayed) input back to its output when it returns, and clears
+     //its oversampler and ADAA history itself first
+     if (!neutralStages.shaper) {
+         prunedStages.shaper = false;
+     }
+     else if (!prunedStages.shaper) {
+         auto dry = shaper.isFullyDry();
+         prunedStages.shaper = dry;
+         pruningPending |= !dry;
+     }
+
+     //Both reverbs glide their wet level up from 0 when they come back, and start from an empty
+     //tank, so that's their fade in. Only the active one's glide moves, so only it is checked.
+     if (!neutralStages.reverb) {
+         if (prunedStages.reverb) {
+             prunedStages.reverb = false;
+             reverb.reset();
+         }
+     }
+     else if (!prunedStages.reverb) {
+         auto dry = useConvolutionReverb ? convolution.isFullyDry() : reverb.isFullyDry();
+         prunedStages.reverb = dry;
+         pruningPending |= !dry;
+     }
+
+     chain.effectChain.template setBypassed<ChainPosition::Gain>(prunedStages.gain);
+     chain.effectChain.template setBypassed<ChainPosition::Shaper>(prunedStages.shaper);
+     chain.effectChain.template setBypassed<ChainPosition::Reverb>(useConvolutionReverb || prunedStages.reverb);
+     chain.effectChain.template setBypassed<ChainPosition::Convolution>(!useConvolutionReverb || prunedStages.reverb);
+
+     //The FDN's delay lines are freed while it isn't running and come back when it is (timerCallback)
+     reverb.setMemoryWanted(isNonRealtime() || (!useConvolutionReverb && !prunedStages.reverb));
+ }
+
+ void WeirdEffectsAudioProcessor::timerCallback() {
+     reportLatency();
+     floatChain.effectChain.get<ChainPosition::Reverb>().updateMemory();
+     doubleChain.effectChain.get<ChainPosition::Reverb>().updateMemory();
+     floatChain.effectChain.get<ChainPosition::Shaper>().updateOversampling();
+     doubleChain.effectChain.get<ChainPosition::Shaper>().updateOversampling();
+ }
+
+ int WeirdEffectsAudioProcessor::getWetPathLatency() const noexcept {
+     //Gain, both reverbs and the IIR cuts are zero latency. Stages that delay the signal add theirs here.
+     auto latency = 0;
+
+     if (activeCutMode == CutMode::CutMode_LinearPhase)
+         latency += getActiveLinearPhaseCuts().getLatencySamples();
+
+     //The oversampler's, whether or not the shaper is pruned
+     latency += isUsingDoublePrecision() ? doubleChain.effectChain.get<ChainPosition::Shaper>().getLatencySamples()
+                                         : floatChain.effectChain.get<ChainPosition::Shaper>().getLatencySamples();
 
-     ChainSettings settings;
+     return latency;
+ }
+
+ template <typename SampleType>
+ void WeirdEffectsAudioProcessor::updateLatency() {
+     shaperLatency = getChain<SampleType>().effectChain.template get<ChainPosition::Shaper>().getLatencySamples();
+     auto latency = juce::jmin(getWetPathLatency(), maxWetLatencySamples);
+
+     //The dry path gets delayed by the same amount so the blend doesn't comb filter
+     getChain<SampleType>().dryWet.setWetLatency(static_cast<SampleType>(latency));
 
-     //Use getRawParameterValue instead of getParameterValue because we don't want
-     //normalized value.
-     settings.gain = tree.getRawParameterValue("Gain")->load();
-     settings.dryWet = tree.getRawParameterValue("Dry/Wet")->load();
-     settings.reverb = tree.getRawParameterValue("Reverb")->load();
-     settings.lowCutFreq = tree.getRawParameterValue("LowCut Freq")->load();
-     settings.highCutFreq = tree.getRawParameterValue("HighCut Freq")->load();
-     settings.lowCutSlope = static_cast<Slope>(tree.getRawParameterValue("Low-Cut Slope")->load());
-     settings.lowCutSlope = static_cast<Slope>(tree.getRawParameterValue("High-Cut Slope")->load());
+     //The FIFO delays dry and wet alike, so only the host needs to know about it. The mode
+     //that's been asked for, processSamples only switches to it once this has been reported.
+     if (requestedBlockMode == BlockMode::BlockMode_Fixed)
+         latency += fixedBlockSize;
 
-     return settings;
+     //The version goes up after the value is written, so a reportLatency that sees it sees the value
+     pendingLatency.store(latency, std::memory_order_relaxed);
+     pendingLatencyVersion.fetch_add(1, std::memory_order_release);
  }
 
- void WeirdEffectsAudioProcessor::setFilterCoefficients(CutFilter& filter, juce::dsp::IIR::Coefficients<float>::Ptr& coefficients, Slope slope) {
-     switch (slope) {
-     case Slope::Slope_12dB:
-         *filter.get<0>().coefficients = *coefficients;
-         break;
-     case Slope::Slope_24dB:
-         *filter.get<0>().coefficients = *coefficients;
-         *filter.get<1>().coefficients = *coefficients;
-         break;
-     case Slope::Slope_36dB:
-         *filter.get<0>().coefficients = *coefficients;
-         *filter.get<0>().coefficients = *coefficients;
-         *filter.get<3>().coefficients = *coefficients;
-         break;
-     default:
-         jassertfalse;
-         break;
+ void WeirdEffectsAudioProcessor::reportLatency() {
+     auto version = pendingLatencyVersion.load(std::memory_order_acquire);
+     if (version == reportedLatencyVersion.load(std::memory_order_relaxed))
+         return;
+
+     auto latency = pendingLatency.load(std::memory_order_relaxed);
+     if (latency != currentLatency.load(std::memory_order_relaxed)) {
+         currentLatency.store(latency, std::memory_order_relaxed);
+         setLatencySamples(latency);
      }
-     //Must dereference to modify actualy filter passed by reference because they are smart pointers
-     
- 
+
+     reportedLatencyVersion.store(version, std::memory_order_release);
  }
 
- void WeirdEffectsAudioProcessor::setBypassLeftRightFilter(CutFilter& leftFilter, CutFilter& rightFilter, bool boolValue){
-     leftFilter.setBypassed<0>(boolValue);
-     leftFilter.setBypassed<1>(boolValue);
-     leftFilter.setBypassed<2>(boolValue);
+ ConvolutionProcessor& WeirdEffectsAudioProcessor::getActiveConvolution() noexcept {
+     return isUsingDoublePrecision() ? doubleChain.effectChain.get<ChainPosition::Convolution>()
+                                     : floatChain.effectChain.get<ChainPosition::Convolution>();
+ }
+
+ const ConvolutionProcessor& WeirdEffectsAudioProcessor::getActiveConvolution() const noexcept {
+     return isUsingDoublePrecision() ? doubleChain.effectChain.get<ChainPosition::Convolution>()
+                                     : floatChain.effectChain.get<ChainPosition::Convolution>();
+ }
+
+ const LinearPhaseCutFilterCascade& WeirdEffectsAudioProcessor::getActiveLinearPhaseCuts() const noexcept {
+     return isUsingDoublePrecision() ? doubleChain.linearPhaseCutFilters : floatChain.linearPhaseCutFilters;
+ }
+
+ bool WeirdEffectsAudioProcessor::loadImpulseResponse(const juce::File& file) {
+     juce::AudioFormatManager formatManager;
+     formatManager.registerBasicFormats();
+
+     std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+     if (reader == nullptr || reader->lengthInSamples <= 0)
+         return false;
+
+     //Anything past the longest impulse the reverb keeps would be thrown away anyway
+     auto maxSamples = (juce::int64)(ConvolutionImpulse::maxLengthSeconds * reader->sampleRate);
+     auto numSamples = (int)juce::jmin(reader->lengthInSamples, maxSamples);
+     auto numChannels = (int)juce::jmin(reader->numChannels, 2u);
+
+     juce::AudioBuffer<float> impulse(numChannels, numSamples);
+     reader->read(&impulse, 0, numSamples, 0, true, numChannels > 1);
 
-     rightFilter.setBypassed<0>(boolValue);
-     rightFilter.setBypassed<1>(boolValue);
-     rightFilter.setBypassed<2>(boolValue);
+     //Both precisions get it, so switching precision later doesn't lose the impulse response
+     juce::AudioBuffer<float> impulseCopy(impulse);
+     floatChain.effectChain.get<ChainPosition::Convolution>().loadImpulseResponse(std::move(impulseCopy), reader->sampleRate);
+     doubleChain.effectChain.get<ChainPosition::Convolution>().loadImpulseResponse(std::move(impulse), reader->sampleRate);
+     valueTree.state.setProperty(impulseResponseFileProperty, file.getFullPathName(), nullptr);
+     return true;
  }
 
 //==============================================================================
@@ -9,41 +9,68 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "CoefficientService.h"
+#include "BiquadCascade.h"
+#include "StateVariableCascade.h"
+#include "LinearPhaseCuts.h"
+#include "CutModulator.h"
+#include "ParameterSnapshot.h"
+#include "RealtimeSafety.h"
+#include "SmoothedGain.h"
+#include "Waveshaper.h"
+#include "StageFadeIn.h"
+#include "FDNReverb.h"
+#include "ConvolutionReverb.h"
+#include "SpectrumAnalyzer.h"
+#include "PresetBank.h"
+#include "PluginState.h"
+#include "TripleBuffer.h"
 
-//Struct for storing current parameter values
-struct ChainSettings {
-    float highCutFreq{ 0 }, lowCutFreq{ 0 };
-    Slope highCutSlope{Slope::Slope_12dB}, lowCutSlope{Slope::Slope_12dB};
-    float gain{ 0 }, dryWet{ 0 };
-    float reverb{ 0 };
-};
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState & Tree);
-
+//Index of each link in EffectChain, so these must stay in the same order as the chain.
+//LowCut and HighCut run before the chain inside CutFilterCascade.
 enum ChainPosition {
-    LowCut,
-    HighCut,
-    CutFilter,
     Gain,
-    DryWet,
+    Shaper,
     Reverb,
-};
-enum Slope {
-    Slope_12dB,
-    Slope_24dB,
-    Slope_36dB,
+    Convolution,
 };
 
-using Filter = juce::dsp::IIR::Filter<float>;
-using GainProcessor = juce::dsp::Gain<float>;
-using ReverbProcessor = juce::dsp::Reverb;
-using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter>;
-//Don't forget to include DryWetProcessor into the chain after GainProcessor
-using MonoChain = juce::dsp::ProcessorChain<CutFilter, CutFilter, GainProcessor, ReverbProcessor>;
+//Every stage is templated on the sample type so the host can run the whole chain in float or
+//double without converting buffers.
+template <typename SampleType>
+using GainProcessor = SmoothedGain<SampleType>;
+//Waveshaper curves and the bitcrusher, optionally oversampled. Oversampling adds latency, which
+//the processor reports once the oversampler is swapped in.
+template <typename SampleType>
+using ShaperProcessor = Waveshaper<SampleType>;
+//8 line feedback delay network, "Reverb" sets its size, decay and mix together
+template <typename SampleType>
+using ReverbProcessor = FDNReverb<SampleType>;
+//Same "Reverb" amount, but through an impulse response. Only one of the two reverbs runs,
+//"Reverb Mode" bypasses the other.
+using ConvolutionProcessor = ConvolutionReverb;
+//LowCut + HighCut for every channel in one SIMD pass
+template <typename SampleType>
+using CutFilterCascade = BiquadCascade<SampleType>;
+//The same cuts as state variable filters, for "Cut Mode" State Variable. Follows the modulation
+//every sample instead of every CoefficientService sub-block.
+template <typename SampleType>
+using ModulatedCutFilterCascade = StateVariableCascade<SampleType>;
+//The same magnitude response again as one linear phase FIR, for "Cut Mode" Linear Phase. Adds
+//latency, which the processor reports while it's the active mode.
+using LinearPhaseCutFilterCascade = LinearPhaseCuts;
+template <typename SampleType>
+using EffectChain = juce::dsp::ProcessorChain<GainProcessor<SampleType>, ShaperProcessor<SampleType>, ReverbProcessor<SampleType>, ConvolutionProcessor>;
+//Blends the untouched input back in after everything else. It needs the dry samples before
+//the chain runs, so it sits around the chain instead of inside it.
+template <typename SampleType>
+using DryWetProcessor = juce::dsp::DryWetMixer<SampleType>;
 
 //==============================================================================
 /**
 */
-class WeirdEffectsAudioProcessor : public juce::AudioProcessor
+class WeirdEffectsAudioProcessor : public juce::AudioProcessor,
+                                   private juce::Timer
 {
 public:
     //==============================================================================
@@ -60,9 +87,16 @@ public:
     bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
 #endif
 
+    //Widest bus accepted, 64 channels is 7th order ambisonics
+    static constexpr int maxChannels = 64;
+
     void processBlock(juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock(juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
     //Do not interrupt this process block as it can result in pops/bangs etc.
 
+    //The chain is built for both, so 64 bit hosts don't have to convert every block
+    bool supportsDoublePrecisionProcessing() const override { return true; }
+
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -76,6 +110,8 @@ public:
     double getTailLengthSeconds() const override;
 
     //==============================================================================
+    //Programs are the factory presets in PresetBank. Recalling one sets the parameters, the cut
+    //coefficients then come out of the shared table like for any other parameter move.
     int getNumPrograms() override;
     int getCurrentProgram() override;
     void setCurrentProgram(int index) override;
@@ -96,14 +132,188 @@ public:
         ;
     juce::AudioProcessorValueTreeState valueTree{*this, nullptr ,"Parameters", createParameterLayout() };
 
-    void setFilterCoefficients(CutFilter& filter, juce::dsp::IIR::Coefficients<float>::Ptr& coefficients, Slope slope);
+    //Allocation/lock counters and per-block timings of the audio callback. Only collects
+    //anything when built with WEIRDEFFECTS_REALTIME_CHECKS=1, see RealtimeSafety.h
+    RealtimeSafety::Monitor& getRealtimeMonitor() noexcept { return realtimeMonitor; }
+
+    //Reads an audio file and hands it to the convolution reverb, which swaps it in once the
+    //partitions are built. The path is kept in the state as ImpulseResponseFile. Message thread.
+    bool loadImpulseResponse(const juce::File& file);
+
+    static constexpr const char* impulseResponseFileProperty = "ImpulseResponseFile";
+
+    //Blocks skipped because the processor was asleep (silent input, tail fully decayed)
+    juce::uint64 getSleptBlocks() const noexcept { return sleptBlocks.load(std::memory_order_relaxed); }
+
+    //Turns the "Morph" parameter into a blend between two presets, -1 for either switches it off.
+    //While it's on the morph drives every stage instead of the individual parameters. Message thread.
+    void setMorphPresets(int presetA, int presetB);
+    int getMorphPresetA() const noexcept { return morphPresetA; }
+    int getMorphPresetB() const noexcept { return morphPresetB; }
+
+    //The session state as XML, for moving settings between tools. setStateInformation accepts
+    //this (through copyXmlToBinary) as well as the binary format getStateInformation writes.
+    std::unique_ptr<juce::XmlElement> createStateXml();
+    void loadStateXml(const juce::XmlElement& xml);
 
-    void setBypassLeftRightFilter(CutFilter& leftFilter,CutFilter& rightFilter, bool boolValue);
+    //Lock free parameter values and change tracking, for anything that redraws when a parameter moves
+    const ParameterSnapshot& getParameterSnapshot() const noexcept { return parameters; }
+
+    //Input and output of processBlock for the editor's spectrum display
+    SpectrumAnalyzer& getSpectrumAnalyzer() noexcept { return spectrumAnalyzer; }
 private:
-    
+    //Every stage for one sample type. Only the one matching the host's processing precision is
+    //prepared and run, the other stays unallocated until the host switches.
+    template <typename SampleType>
+    struct ProcessingChain {
+        //LowCut/HighCut sections for all channels, packed into SIMD lanes
+        CutFilterCascade<SampleType> cutFilters;
+        //Only one of the three cut cascades runs, picked by "Cut Mode"
+        ModulatedCutFilterCascade<SampleType> modulatedCutFilters;
+        LinearPhaseCutFilterCascade linearPhaseCutFilters;
+        //Fades the cuts back in after they were pruned
+        StageFadeIn<SampleType> cutFadeIn;
+
+        //Gain, the waveshaper and the two reverbs, processing every channel of the block together
+        EffectChain<SampleType> effectChain;
+
+        //"Block Mode" Fixed: the block being collected from the host and the processed block
+        //being played back, sharing one buffer (see processFixedBlocks)
+        juce::AudioBuffer<SampleType> fifo;
+
+        //Dry/Wet of the entire effect. The dry delay line and buffer are allocated in prepareToPlay,
+        //sized for the longest wet path latency any stage can report.
+        DryWetProcessor<SampleType> dryWet{ maxWetLatencySamples };
+    };
+
+    template <typename SampleType>
+    ProcessingChain<SampleType>& getChain() noexcept {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleChain;
+        else
+            return floatChain;
+    }
+
+    ConvolutionProcessor& getActiveConvolution() noexcept;
+    const ConvolutionProcessor& getActiveConvolution() const noexcept;
+    const LinearPhaseCutFilterCascade& getActiveLinearPhaseCuts() const noexcept;
+
+    template <typename SampleType>
+    void prepareChain(const juce::dsp::ProcessSpec& spec);
+
+    //Both processBlock overloads end up here. Splits the host's block up according to "Block Mode"
+    //and hands the pieces to processChunk.
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer);
+
+    //Re-blocks through the chain's FIFO so processChunk always gets fixedBlockSize samples, at
+    //the cost of fixedBlockSize samples of latency
+    template <typename SampleType>
+    void processFixedBlocks(juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    //Runs the whole chain on at most maxChunkSize samples. pollParameters false skips looking
+    //for parameter changes, for tiny host blocks that share that work.
+    template <typename SampleType>
+    void processChunk(juce::dsp::AudioBlock<SampleType> block, bool pollParameters);
+
+    //Recomputes only the stages whose parameters are in the changes mask (see ParameterSnapshot)
+    template <typename SampleType>
+    void updateStages(juce::uint32 changes, const ChainSettings& settings);
+
+    //Takes stages whose settings do nothing out of the processing path, and puts them back as
+    //soon as they do something again. Runs after updateStages, and every block while a stage
+    //is still gliding towards a neutral setting.
+    template <typename SampleType>
+    void updatePruning() noexcept;
+
+    //Message thread housekeeping: telling the host about a new latency, the FDN's delay memory for
+    //pruned stages, and building the waveshaper's oversampler when its setting changes
+    void timerCallback() override;
+
+    //Total latency of everything between pushing the dry samples and mixing the wet ones back in
+    int getWetPathLatency() const noexcept;
+
+    //Delays the dry path to line up with the wet path and queues the total for the host. Call
+    //whenever a stage's latency may have changed, fine on the audio thread.
+    template <typename SampleType>
+    void updateLatency();
+
+    //Message thread. setLatencySamples tells the host through updateHostDisplay, which locks and
+    //may make the host restart processing, so the audio thread only ever queues the number.
+    void reportLatency();
+
+    //True when every sample of the first numChannels channels is below silenceThreshold
+    template <typename SampleType>
+    static bool isSilent(const juce::dsp::AudioBlock<SampleType>& block, int numChannels) noexcept;
+
+    //What the chain should run with right now: the parameters, or the morph between two presets.
+    //Reads the morph pair from the audio thread's side of the TripleBuffer.
+    ChainSettings getEffectiveSettings() const noexcept;
+
+    PluginStateData captureState() const;
+    void applyState(const PluginStateData& state);
+
+    //Parameter handles resolved once, so processBlock never looks parameters up by name
+    ParameterSnapshot parameters{ valueTree };
+    ParameterSnapshot::Reader parameterReader;
+
+    static constexpr int maxWetLatencySamples = 16384;
+    ProcessingChain<float> floatChain;
+    ProcessingChain<double> doubleChain;
+    //The latency last queued by updateLatency, and a version that goes up with every queued value.
+    //Once reportLatency has passed a version on to the host it's stored in reportedLatencyVersion.
+    std::atomic<int> pendingLatency{ 0 }, currentLatency{ 0 };
+    std::atomic<juce::uint32> pendingLatencyVersion{ 0 }, reportedLatencyVersion{ 0 };
+    //What the waveshaper's oversampler added to currentLatency, to notice when a new one is swapped in
+    int shaperLatency{ 0 };
+
+    //Block handling. Fixed blocks are about 2ms, rounded up to a power of two, and the chain is
+    //prepared for whichever is longer of that and the host's block size.
+    //A change is held in requestedBlockMode until reportedLatencyVersion reaches blockModeLatencyVersion.
+    BlockMode blockMode{ BlockMode::BlockMode_ZeroLatency }, requestedBlockMode{ BlockMode::BlockMode_ZeroLatency };
+    juce::uint32 blockModeLatencyVersion{ 0 };
+    int fixedBlockSize{ 64 }, maxChunkSize{ 64 }, fifoPosition{ 0 };
+    //Zero latency with blocks shorter than a CoefficientService sub-block: parameters are polled
+    //and cut coefficients looked up only once this many samples have gone by
+    int samplesSinceParameterPoll{ 0 }, samplesSinceCoefficientUpdate{ 0 };
+
+    //Glides LowCut/HighCut towards their parameters and looks up coefficients for each sub-block
+    CoefficientService coefficientService{ parameters };
+
+    //LFO/envelope offsets for the cut frequencies, shared by the Butterworth and state variable modes
+    CutModulator cutModulator;
+    CutMode activeCutMode{ CutMode::CutMode_Butterworth };
+    bool useConvolutionReverb{ false };
+
+    //Stage pruning. A stage is neutral when its settings leave the signal as it is: both cuts at
+    //the ends of their ranges with no modulation, 0dB of gain, Shape Off with the crusher off, or
+    //no reverb. Once it has also finished gliding there it's pruned and costs nothing until a
+    //setting moves again (an oversampled shaper still delays the signal by its latency).
+    static constexpr float minCutFrequency = 20.f, maxCutFrequency = 20000.f;
+
+    struct StageFlags {
+        bool cuts{ false }, gain{ false }, shaper{ false }, reverb{ false };
+    };
+    StageFlags neutralStages, prunedStages;
+    bool pruningPending{ false };
+
+    RealtimeSafety::Monitor realtimeMonitor;
+
+    //Message thread side of the programs and the morph
+    int currentProgram{ 0 };
+    int morphPresetA{ -1 }, morphPresetB{ -1 };
+    TripleBuffer<MorphPresets> morphPresets;
+
+    //Only copies samples into its FIFOs while an editor is showing it
+    SpectrumAnalyzer spectrumAnalyzer;
 
-    //Creates a stereo chain using MonoChain, right and left
-    MonoChain leftChain, rightChain;
+    //Sleep mode. Once the input has been silent for longer than getTailLengthSeconds() and the
+    //output has died away as well, processBlock skips the DSP until a non-silent sample arrives.
+    //The filter and reverb states are all below the threshold by then, so waking up doesn't click.
+    static constexpr float silenceThreshold = 1.0e-5f; //-100dB
+    juce::int64 silentSamples{ 0 };
+    bool sleeping{ false };
+    std::atomic<juce::uint64> sleptBlocks{ 0 };
 
 
 
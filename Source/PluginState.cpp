@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    PluginState.cpp
+
+  ==============================================================================
+*/
+
+#include "PluginState.h"
+
+namespace PluginState {
+
+    //"WEfx" read as a little endian int32
+    static constexpr int magic = 0x78664557;
+
+    static const juce::Identifier programProperty{ "Program" };
+    static const juce::Identifier morphPresetAProperty{ "MorphPresetA" };
+    static const juce::Identifier morphPresetBProperty{ "MorphPresetB" };
+    static const juce::Identifier impulseResponseFileProperty{ "ImpulseResponseFile" };
+
+    //The value tree state's XML has one PARAM child per parameter
+    static const juce::Identifier parameterTag{ "PARAM" };
+    static const juce::Identifier idAttribute{ "id" };
+    static const juce::Identifier valueAttribute{ "value" };
+
+    void writeBinary(const PluginStateData& state, juce::MemoryBlock& destination) {
+        juce::MemoryOutputStream stream(destination, false);
+
+        stream.writeInt(magic);
+        stream.writeShort((short)currentVersion);
+
+        stream.writeByte((char)NumChainParameters);
+        for (auto value : state.values)
+            stream.writeFloat(value);
+
+        stream.writeInt(state.program);
+        stream.writeByte((char)state.morphPresetA);
+        stream.writeByte((char)state.morphPresetB);
+        stream.writeString(state.impulseResponseFile);
+    }
+
+    bool readBinary(const void* data, int sizeInBytes, PluginStateData& state) {
+        juce::MemoryInputStream stream(data, (size_t)juce::jmax(0, sizeInBytes), false);
+
+        if (sizeInBytes < 7 || stream.readInt() != magic)
+            return false;
+
+        //A newer build's state still starts with everything this one knows about
+        stream.readShort();
+
+        auto numValues = (int)(juce::uint8)stream.readByte();
+        for (int i = 0; i < numValues; ++i) {
+            auto value = stream.readFloat();
+            if (i < NumChainParameters)
+                state.values[(size_t)i] = value;
+        }
+
+        //Fields added after version 1 go after these, each behind a stream.isExhausted() check
+        if (!stream.isExhausted()) {
+            state.program = stream.readInt();
+            state.morphPresetA = (int)(signed char)stream.readByte();
+            state.morphPresetB = (int)(signed char)stream.readByte();
+            state.impulseResponseFile = stream.readString();
+        }
+
+        return true;
+    }
+
+    std::unique_ptr<juce::XmlElement> createXml(const PluginStateData& state, const juce::Identifier& tagName) {
+        auto xml = std::make_unique<juce::XmlElement>(tagName);
+
+        xml->setAttribute(programProperty, state.program);
+        xml->setAttribute(morphPresetAProperty, state.morphPresetA);
+        xml->setAttribute(morphPresetBProperty, state.morphPresetB);
+        if (state.impulseResponseFile.isNotEmpty())
+            xml->setAttribute(impulseResponseFileProperty, state.impulseResponseFile);
+
+        for (int i = 0; i < NumChainParameters; ++i) {
+            auto* parameter = xml->createNewChildElement(parameterTag);
+            parameter->setAttribute(idAttribute, ParameterSnapshot::getParameterID(static_cast<ChainParameter>(i)));
+            parameter->setAttribute(valueAttribute, state.values[(size_t)i]);
+        }
+
+        return xml;
+    }
+
+    bool readXml(const juce::XmlElement& xml, PluginStateData& state) {
+        auto foundAny = false;
+
+        for (auto* parameter : xml.getChildWithTagNameIterator(parameterTag.toString())) {
+            auto id = parameter->getStringAttribute(idAttribute);
+
+            for (int i = 0; i < NumChainParameters; ++i) {
+                if (id == ParameterSnapshot::getParameterID(static_cast<ChainParameter>(i))) {
+                    state.values[(size_t)i] = (float)parameter->getDoubleAttribute(valueAttribute, state.values[(size_t)i]);
+                    foundAny = true;
+                }
+            }
+        }
+
+        state.program = xml.getIntAttribute(programProperty, state.program);
+        state.morphPresetA = xml.getIntAttribute(morphPresetAProperty, state.morphPresetA);
+        state.morphPresetB = xml.getIntAttribute(morphPresetBProperty, state.morphPresetB);
+        state.impulseResponseFile = xml.getStringAttribute(impulseResponseFileProperty, state.impulseResponseFile);
+
+        return foundAny;
+    }
+}
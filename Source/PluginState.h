@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    PluginState.h
+
+    Compact binary session state, with XML for interchange.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterSnapshot.h"
+
+//Everything getStateInformation saves. Parameter values are plain (not normalised).
+struct PluginStateData {
+    std::array<float, NumChainParameters> values{};
+    int program{ 0 };
+    int morphPresetA{ -1 }, morphPresetB{ -1 };
+    juce::String impulseResponseFile;
+};
+
+//The binary format is what hosts store in sessions. It's a few dozen bytes with no parsing
+//beyond reading numbers, so recalling hundreds of instances is quick:
+//
+//  int32   magic "WEfx"
+//  int16   version
+//  uint8   number of parameter values n, then n float32 in ChainParameter order
+//  int32   current program
+//  int8    morph preset A, int8 morph preset B (-1 = off)
+//  string  impulse response path, UTF-8, zero terminated
+//
+//All little endian. Newer versions only ever append, so a reader takes the fields it knows,
+//and parameters a state doesn't contain (saved before they existed) keep their defaults.
+//
+//Anything not starting with the magic goes through the XML path instead, which is the
+//AudioProcessorValueTreeState XML JUCE plugins usually store. That's also what the XML
+//functions below write, for moving settings to and from other tools.
+namespace PluginState {
+
+    constexpr int currentVersion = 1;
+
+    void writeBinary(const PluginStateData& state, juce::MemoryBlock& destination);
+
+    //True if data is in the binary format. state starts out with whatever defaults the caller
+    //wants for fields the data doesn't have.
+    bool readBinary(const void* data, int sizeInBytes, PluginStateData& state);
+
+    //XML as the value tree state writes it, with the extra fields as properties
+    std::unique_ptr<juce::XmlElement> createXml(const PluginStateData& state, const juce::Identifier& tagName);
+    bool readXml(const juce::XmlElement& xml, PluginStateData& state);
+}
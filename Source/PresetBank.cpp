@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    PresetBank.cpp
+
+  ==============================================================================
+*/
+
+#include "PresetBank.h"
+
+namespace PresetBank {
+
+    static ChainSettings makeSettings(float lowCutFreq, Slope lowCutSlope, float highCutFreq, Slope highCutSlope,
+                                      float gain, float dryWet, float reverb, ReverbMode reverbMode) {
+        ChainSettings settings;
+        settings.lowCutFreq = lowCutFreq;
+        settings.lowCutSlope = lowCutSlope;
+        settings.highCutFreq = highCutFreq;
+        settings.highCutSlope = highCutSlope;
+        settings.gain = gain;
+        settings.dryWet = dryWet;
+        settings.reverb = reverb;
+        settings.reverbMode = reverbMode;
+        return settings;
+    }
+
+    //Every preset sets the cut mode and modulation too, so recalling one never keeps whatever
+    //the previous preset left there
+    static ChainSettings withModulation(ChainSettings settings, CutMode cutMode, float modRate, float modDepth, float modEnvelope) {
+        settings.cutMode = cutMode;
+        settings.modRate = modRate;
+        settings.modDepth = modDepth;
+        settings.modEnvelope = modEnvelope;
+        return settings;
+    }
+
+    //Likewise the waveshaper and crusher
+    static ChainSettings withShaper(ChainSettings settings, Shape shape, float drive, float crushRate, float crushBits) {
+        settings.shape = shape;
+        settings.drive = drive;
+        settings.crushRate = crushRate;
+        settings.crushBits = crushBits;
+        return settings;
+    }
+
+    //Init matches the parameter defaults in createParameterLayout. None of them use Linear Phase,
+    //the morph couldn't switch it on anyway.
+    static const Preset presets[] = {
+        { "Init",         withShaper(withModulation(makeSettings(20.f,   Slope_12dB, 20000.f, Slope_12dB,  0.f, 100.f,  0.f, ReverbMode_Algorithmic),
+                                           CutMode_Butterworth,   1.f,   0.f,   0.f),
+                                         Shape_Off,        0.f,  1.f, 24.f) },
+        { "Telephone",    withShaper(withModulation(makeSettings(400.f,  Slope_36dB, 3400.f,  Slope_36dB,  4.f, 100.f,  0.f, ReverbMode_Algorithmic),
+                                           CutMode_Butterworth,   1.f,   0.f,   0.f),
+                                         Shape_Tanh,       9.f,  2.f, 12.f) },
+        { "Small Room",   withShaper(withModulation(makeSettings(80.f,   Slope_12dB, 12000.f, Slope_12dB,  0.f,  35.f, 25.f, ReverbMode_Algorithmic),
+                                           CutMode_Butterworth,   1.f,   0.f,   0.f),
+                                         Shape_Off,        0.f,  1.f, 24.f) },
+        { "Big Hall",     withShaper(withModulation(makeSettings(120.f,  Slope_24dB, 9000.f,  Slope_12dB, -3.f,  60.f, 85.f, ReverbMode_Algorithmic),
+                                           CutMode_Butterworth,   0.2f,  0.15f, 0.f),
+                                         Shape_Off,        0.f,  1.f, 24.f) },
+        { "Underwater",   withShaper(withModulation(makeSettings(20.f,   Slope_12dB, 600.f,   Slope_36dB,  2.f, 100.f, 40.f, ReverbMode_Algorithmic),
+                                           CutMode_StateVariable, 0.3f,  1.f,   0.5f),
+                                         Shape_Asymmetric, 4.f,  1.f, 24.f) },
+        { "Thin Air",     withShaper(withModulation(makeSettings(2500.f, Slope_24dB, 20000.f, Slope_12dB, -6.f,  70.f, 60.f, ReverbMode_Algorithmic),
+                                           CutMode_StateVariable, 0.1f,  0.5f,  0.f),
+                                         Shape_Off,        0.f,  1.f, 24.f) },
+        { "Impulse Room", withShaper(withModulation(makeSettings(60.f,   Slope_12dB, 16000.f, Slope_12dB,  0.f,  50.f, 50.f, ReverbMode_Convolution),
+                                           CutMode_Butterworth,   1.f,   0.f,   0.f),
+                                         Shape_Off,        0.f,  1.f, 24.f) },
+    };
+
+    int getNumPresets() noexcept {
+        return (int)std::size(presets);
+    }
+
+    const Preset& getPreset(int index) noexcept {
+        return presets[juce::jlimit(0, getNumPresets() - 1, index)];
+    }
+
+    ChainSettings interpolate(const ChainSettings& a, const ChainSettings& b, float amount) noexcept {
+        amount = juce::jlimit(0.f, 1.f, amount);
+
+        auto linear = [amount](float from, float to) { return from + amount * (to - from); };
+        auto logarithmic = [amount](float from, float to) { return from * std::pow(to / from, amount); };
+
+        ChainSettings result = amount < 0.5f ? a : b;
+        result.lowCutFreq = logarithmic(a.lowCutFreq, b.lowCutFreq);
+        result.highCutFreq = logarithmic(a.highCutFreq, b.highCutFreq);
+        result.gain = linear(a.gain, b.gain);
+        result.dryWet = linear(a.dryWet, b.dryWet);
+        result.reverb = linear(a.reverb, b.reverb);
+        result.modRate = logarithmic(a.modRate, b.modRate);
+        result.modDepth = linear(a.modDepth, b.modDepth);
+        result.modEnvelope = linear(a.modEnvelope, b.modEnvelope);
+        result.drive = linear(a.drive, b.drive);
+        result.crushRate = logarithmic(a.crushRate, b.crushRate);
+        result.crushBits = linear(a.crushBits, b.crushBits);
+        return result;
+    }
+}
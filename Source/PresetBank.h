@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    PresetBank.h
+
+    Factory presets and the A/B morph between two of them.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterSnapshot.h"
+
+struct Preset {
+    const char* name;
+    ChainSettings settings;
+};
+
+namespace PresetBank {
+
+    //The factory bank is static data, recalling a preset never allocates
+    int getNumPresets() noexcept;
+    const Preset& getPreset(int index) noexcept;
+
+    //Blend of a and b at amount 0..1. Cut frequencies move in octaves so a sweep sounds even,
+    //gain moves in dB and the slopes, cut mode and reverb mode switch over halfway. The processor
+    //never lets the morph switch Linear Phase on or off, that changes the latency. No allocation,
+    //no design maths, fine on the audio thread.
+    ChainSettings interpolate(const ChainSettings& a, const ChainSettings& b, float amount) noexcept;
+}
+
+//The two presets the "Morph" parameter blends between. Published by the message thread and
+//read on the audio thread through a TripleBuffer, so changing them never blocks processBlock.
+struct MorphPresets {
+    //-1 when morphing is off
+    int presetA{ -1 }, presetB{ -1 };
+    ChainSettings a, b;
+
+    bool isEnabled() const noexcept { return presetA >= 0 && presetB >= 0; }
+};
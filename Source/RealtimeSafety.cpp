@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafety.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace RealtimeSafety {
+
+   #if WEIRDEFFECTS_REALTIME_CHECKS
+    //Counters of the ScopedAudioCallback active on this thread, nullptr outside the callback.
+    //A plain pointer so reading it from operator new can never allocate.
+    static thread_local BlockCounters* activeCounters = nullptr;
+   #endif
+
+    void countLock() noexcept {
+       #if WEIRDEFFECTS_REALTIME_CHECKS
+        if (auto* counters = activeCounters)
+            ++counters->locks;
+       #endif
+    }
+
+    void Monitor::reset() noexcept {
+        blocks = 0;
+        blocksWithViolations = 0;
+        allocations = 0;
+        deallocations = 0;
+        locks = 0;
+        peakLoad = 0.f;
+    }
+
+    Totals Monitor::getTotals() const noexcept {
+        Totals totals;
+        totals.blocks = blocks.load(std::memory_order_relaxed);
+        totals.blocksWithViolations = blocksWithViolations.load(std::memory_order_relaxed);
+        totals.allocations = allocations.load(std::memory_order_relaxed);
+        totals.deallocations = deallocations.load(std::memory_order_relaxed);
+        totals.locks = locks.load(std::memory_order_relaxed);
+        totals.peakLoad = peakLoad.load(std::memory_order_relaxed);
+        return totals;
+    }
+
+    void Monitor::record(const BlockTiming& timing) noexcept {
+        blocks.fetch_add(1, std::memory_order_relaxed);
+        allocations.fetch_add(timing.counters.allocations, std::memory_order_relaxed);
+        deallocations.fetch_add(timing.counters.deallocations, std::memory_order_relaxed);
+        locks.fetch_add(timing.counters.locks, std::memory_order_relaxed);
+
+        if (timing.counters.allocations + timing.counters.deallocations + timing.counters.locks > 0)
+            blocksWithViolations.fetch_add(1, std::memory_order_relaxed);
+
+        //Only the audio thread writes the peak, so a plain compare is enough
+        if (timing.load > peakLoad.load(std::memory_order_relaxed))
+            peakLoad.store(timing.load, std::memory_order_relaxed);
+
+        //If the GUI isn't reading (editor closed) the ring fills up and new timings are dropped
+        int start1, size1, start2, size2;
+        timingFifo.prepareToWrite(1, start1, size1, start2, size2);
+        if (size1 > 0)
+            timings[(size_t)start1] = timing;
+        timingFifo.finishedWrite(size1);
+    }
+
+    int Monitor::popBlockTimings(BlockTiming* destination, int maxTimings) noexcept {
+        int start1, size1, start2, size2;
+        timingFifo.prepareToRead(maxTimings, start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)
+            destination[i] = timings[(size_t)(start1 + i)];
+        for (int i = 0; i < size2; ++i)
+            destination[size1 + i] = timings[(size_t)(start2 + i)];
+
+        timingFifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+   #if WEIRDEFFECTS_REALTIME_CHECKS
+    ScopedAudioCallback::ScopedAudioCallback(Monitor& monitor, int numSamples) noexcept
+        : owner(monitor), blockSize(numSamples), startTicks(juce::Time::getHighResolutionTicks()),
+          previous(activeCounters) {
+        activeCounters = &counters;
+    }
+
+    ScopedAudioCallback::~ScopedAudioCallback() noexcept {
+        activeCounters = previous;
+
+        auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        auto blockSeconds = (double)blockSize / owner.currentSampleRate;
+
+        BlockTiming timing;
+        timing.microseconds = (float)(seconds * 1.0e6);
+        timing.load = blockSeconds > 0.0 ? (float)(seconds / blockSeconds) : 0.f;
+        timing.counters = counters;
+        owner.record(timing);
+    }
+   #else
+    ScopedAudioCallback::ScopedAudioCallback(Monitor&, int) noexcept {}
+    ScopedAudioCallback::~ScopedAudioCallback() noexcept {}
+   #endif
+}
+
+#if WEIRDEFFECTS_REALTIME_CHECKS
+//==============================================================================
+//Replacement global allocation functions. They behave exactly like the defaults, they just
+//charge the call to the active ScopedAudioCallback first.
+namespace {
+    void countAllocation() noexcept {
+        if (auto* counters = RealtimeSafety::activeCounters)
+            ++counters->allocations;
+    }
+
+    void countDeallocation() noexcept {
+        if (auto* counters = RealtimeSafety::activeCounters)
+            ++counters->deallocations;
+    }
+}
+
+#if WEIRDEFFECTS_WRAP_MALLOC
+//The linker sends every malloc/calloc/realloc/free in the plugin and JUCE code here
+//(-Wl,--wrap=malloc...), __real_malloc and friends are the C library's own.
+extern "C" {
+    void* __real_malloc(std::size_t size);
+    void* __real_calloc(std::size_t count, std::size_t size);
+    void* __real_realloc(void* pointer, std::size_t size);
+    void __real_free(void* pointer);
+
+    void* __wrap_malloc(std::size_t size) {
+        countAllocation();
+        return __real_malloc(size);
+    }
+
+    void* __wrap_calloc(std::size_t count, std::size_t size) {
+        countAllocation();
+        return __real_calloc(count, size);
+    }
+
+    //Moving a block counts as both, growing or shrinking one in place still went to the allocator
+    void* __wrap_realloc(void* pointer, std::size_t size) {
+        if (pointer != nullptr)
+            countDeallocation();
+        if (size > 0)
+            countAllocation();
+        return __real_realloc(pointer, size);
+    }
+
+    void __wrap_free(void* pointer) {
+        if (pointer != nullptr)
+            countDeallocation();
+        __real_free(pointer);
+    }
+}
+
+//operator new/delete count themselves, so they go straight to the unwrapped versions
+#define WEIRDEFFECTS_MALLOC __real_malloc
+#define WEIRDEFFECTS_FREE __real_free
+#else
+#define WEIRDEFFECTS_MALLOC std::malloc
+#define WEIRDEFFECTS_FREE std::free
+#endif
+
+namespace {
+    void* allocate(std::size_t size) {
+        countAllocation();
+        if (auto* pointer = WEIRDEFFECTS_MALLOC(size == 0 ? 1 : size))
+            return pointer;
+        throw std::bad_alloc();
+    }
+
+    void* allocateAligned(std::size_t size, std::align_val_t alignment) {
+        countAllocation();
+        auto align = juce::jmax(sizeof(void*), static_cast<std::size_t>(alignment));
+        size = ((size == 0 ? 1 : size) + align - 1) / align * align;
+
+       #if JUCE_WINDOWS
+        if (auto* pointer = _aligned_malloc(size, align))
+            return pointer;
+       #else
+        if (auto* pointer = std::aligned_alloc(align, size))
+            return pointer;
+       #endif
+        throw std::bad_alloc();
+    }
+
+    void deallocate(void* pointer) noexcept {
+        if (pointer == nullptr)
+            return;
+        countDeallocation();
+        WEIRDEFFECTS_FREE(pointer);
+    }
+
+    void deallocateAligned(void* pointer) noexcept {
+        if (pointer == nullptr)
+            return;
+        countDeallocation();
+       #if JUCE_WINDOWS
+        _aligned_free(pointer);
+       #else
+        WEIRDEFFECTS_FREE(pointer);
+       #endif
+    }
+}
+
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { try { return allocate(size); } catch (...) { return nullptr; } }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { try { return allocate(size); } catch (...) { return nullptr; } }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { deallocateAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { deallocateAligned(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { deallocateAligned(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { deallocateAligned(pointer); }
+#endif
@@ -0,0 +1,117 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.h
+
+    Opt-in checks that the audio callback never allocates or locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Build with WEIRDEFFECTS_REALTIME_CHECKS=1 to turn the instrumentation on. That replaces the
+//global operator new/delete with versions that count calls made while a ScopedAudioCallback
+//is alive on the current thread, so it is meant for debug/benchmark builds, not releases.
+//WEIRDEFFECTS_WRAP_MALLOC=1 counts malloc/calloc/realloc/free as well, it needs the link to
+//wrap them (-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free, GNU ld and lld only).
+//Every CriticalSection the processor and its DSP classes take goes through RealtimeSafety::ScopedLock.
+//WaitableEvents and ReadWriteLocks aren't counted, none of them is ever used on the audio thread.
+#ifndef WEIRDEFFECTS_REALTIME_CHECKS
+ #define WEIRDEFFECTS_REALTIME_CHECKS 0
+#endif
+
+#ifndef WEIRDEFFECTS_WRAP_MALLOC
+ #define WEIRDEFFECTS_WRAP_MALLOC 0
+#endif
+
+namespace RealtimeSafety {
+
+    constexpr bool isEnabled() noexcept { return WEIRDEFFECTS_REALTIME_CHECKS != 0; }
+
+    //What happened during one processBlock
+    struct BlockCounters {
+        juce::uint32 allocations{ 0 }, deallocations{ 0 }, locks{ 0 };
+    };
+
+    struct BlockTiming {
+        float microseconds{ 0 };
+        //Share of the time the block represents, 1.0 means the callback took as long as the audio lasts
+        float load{ 0 };
+        BlockCounters counters;
+    };
+
+    struct Totals {
+        juce::uint64 blocks{ 0 }, blocksWithViolations{ 0 };
+        juce::uint64 allocations{ 0 }, deallocations{ 0 }, locks{ 0 };
+        float peakLoad{ 0 };
+    };
+
+    //Call from anything that takes a lock which might end up on the audio thread.
+    //Does nothing unless the instrumentation is on and a callback is active on this thread.
+    void countLock() noexcept;
+
+    //Owned by the processor. The audio thread writes, the GUI reads, neither side ever waits.
+    class Monitor {
+    public:
+        Monitor() = default;
+
+        void prepare(double sampleRate) noexcept { currentSampleRate = sampleRate; }
+        void reset() noexcept;
+
+        Totals getTotals() const noexcept;
+
+        //Pops up to maxTimings of the most recent per-block timings, oldest first. GUI thread only.
+        int popBlockTimings(BlockTiming* destination, int maxTimings) noexcept;
+
+    private:
+        friend class ScopedAudioCallback;
+
+        void record(const BlockTiming& timing) noexcept;
+
+        double currentSampleRate{ 44100.0 };
+
+        std::atomic<juce::uint64> blocks{ 0 }, blocksWithViolations{ 0 };
+        std::atomic<juce::uint64> allocations{ 0 }, deallocations{ 0 }, locks{ 0 };
+        std::atomic<float> peakLoad{ 0 };
+
+        //Lock free single producer/single consumer ring of block timings
+        static constexpr int timingCapacity = 1024;
+        juce::AbstractFifo timingFifo{ timingCapacity };
+        std::array<BlockTiming, timingCapacity> timings;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Monitor)
+    };
+
+    //Put one at the top of processBlock. While it's alive, allocations, frees and counted locks
+    //on this thread are charged to the block, and its destructor records the block's time.
+    class ScopedAudioCallback {
+    public:
+        ScopedAudioCallback(Monitor& monitor, int numSamples) noexcept;
+        ~ScopedAudioCallback() noexcept;
+
+    private:
+       #if WEIRDEFFECTS_REALTIME_CHECKS
+        Monitor& owner;
+        int blockSize;
+        juce::int64 startTicks;
+        BlockCounters counters;
+        BlockCounters* previous;
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedAudioCallback)
+    };
+
+    //juce::ScopedLock that also gets counted if it is ever taken inside the audio callback
+    class ScopedLock {
+    public:
+        explicit ScopedLock(const juce::CriticalSection& lock) noexcept : scopedLock(lock) { countLock(); }
+
+    private:
+        const juce::ScopedLock scopedLock;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedLock)
+    };
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    ResponseCurveDisplay.cpp
+
+  ==============================================================================
+*/
+
+#include "ResponseCurveDisplay.h"
+
+ResponseCurveDisplay::ResponseCurveDisplay(juce::AudioProcessor& processorToShow, const ParameterSnapshot& parametersToShow)
+    : processor(processorToShow), parameters(parametersToShow) {
+    for (int i = 0; i < numPoints; ++i)
+        frequencies[(size_t)i] = minFrequency * std::pow(maxFrequency / minFrequency, (float)i / (float)(numPoints - 1));
+
+    setInterceptsMouseClicks(false, false);
+
+    //Draw something straight away instead of waiting for the first tick
+    timerCallback();
+    startTimerHz(30);
+}
+
+void ResponseCurveDisplay::paint(juce::Graphics& g) {
+    auto width = (float)getWidth();
+    auto height = (float)getHeight();
+    auto pixelsPerDecibel = height / (topDecibels - bottomDecibels);
+
+    auto toBounds = juce::AffineTransform::scale(width, -pixelsPerDecibel)
+                        .translated(0.f, topDecibels * pixelsPerDecibel);
+
+    g.setColour(juce::Colours::white);
+    g.strokePath(curve, juce::PathStrokeType(2.f), toBounds);
+}
+
+void ResponseCurveDisplay::timerCallback() {
+    //Before the first prepareToPlay the host hasn't told us a rate yet
+    auto sampleRate = processor.getSampleRate() > 0.0 ? processor.getSampleRate() : 44100.0;
+    if (sampleRate != preparedSampleRate)
+        prepareResponse(sampleRate);
+
+    if ((parameterReader.pollChanges(parameters) & (ParameterSnapshot::cutMask | ParameterSnapshot::gainMask)) == 0)
+        return;
+
+    updateCurve();
+    repaint();
+}
+
+void ResponseCurveDisplay::prepareResponse(double sampleRate) {
+    preparedSampleRate = sampleRate;
+    response.prepare(frequencies.data(), numPoints, sampleRate);
+
+    //New rate, new curve even though no parameter moved
+    parameterReader.markAllChanged();
+}
+
+void ResponseCurveDisplay::updateCurve() {
+    auto settings = parameters.getSettings();
+
+    //A handful of tan() calls, the same designs the table on the audio thread interpolates
+    auto lowCut = CutFilterDesign::makeLowCut(settings.lowCutFreq, preparedSampleRate, (int)settings.lowCutSlope + 1);
+    auto highCut = CutFilterDesign::makeHighCut(settings.highCutFreq, preparedSampleRate, (int)settings.highCutSlope + 1);
+    response.process(lowCut, highCut, settings.gain, decibels.data());
+
+    //Clamped just outside the visible range, so off-screen parts are straight lines and not huge numbers
+    auto clampDecibels = [](float value) { return juce::jlimit(bottomDecibels - 1.f, topDecibels + 1.f, value); };
+
+    curve.clear();
+    curve.preallocateSpace(numPoints * 3);
+    curve.startNewSubPath(0.f, clampDecibels(decibels[0]));
+
+    for (int i = 1; i < numPoints; ++i)
+        curve.lineTo((float)i / (float)(numPoints - 1), clampDecibels(decibels[(size_t)i]));
+}
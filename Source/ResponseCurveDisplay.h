@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    ResponseCurveDisplay.h
+
+    Editor overlay drawing the combined LowCut/HighCut/Gain response.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CutFilterResponse.h"
+#include "ParameterSnapshot.h"
+
+//Transparent, sits on top of the SpectrumDisplay with the same log frequency axis.
+//
+//The curve is evaluated at a fixed set of frequencies and kept as a path in (0..1, dB) units,
+//which paint() maps onto the current bounds with a transform. So the maths only runs when a
+//cut, slope or gain parameter moves (or the sample rate changes), never on resize or repaint.
+class ResponseCurveDisplay : public juce::Component,
+                             private juce::Timer {
+public:
+    ResponseCurveDisplay(juce::AudioProcessor& processorToShow, const ParameterSnapshot& parametersToShow);
+
+    void paint(juce::Graphics& g) override;
+
+private:
+    void timerCallback() override;
+
+    void prepareResponse(double sampleRate);
+    void updateCurve();
+
+    //Same range as the spectrum display's x axis
+    static constexpr float minFrequency = 20.f;
+    static constexpr float maxFrequency = 20000.f;
+    static constexpr int numPoints = 512;
+
+    //Range shown on the y axis, so a full gain cut still stays in view
+    static constexpr float topDecibels = 12.f;
+    static constexpr float bottomDecibels = -48.f;
+
+    juce::AudioProcessor& processor;
+    const ParameterSnapshot& parameters;
+    ParameterSnapshot::Reader parameterReader;
+
+    CutFilterResponse response;
+    double preparedSampleRate{ 0 };
+
+    std::array<float, numPoints> frequencies, decibels;
+    juce::Path curve;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ResponseCurveDisplay)
+};
@@ -0,0 +1,115 @@
+/*
+  ==============================================================================
+
+    SmoothedGain.h
+
+    Per sample gain ramp applied with vector operations.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//Drop-in for juce::dsp::Gain. While the gain is moving, Gain asks its SmoothedValue for the
+//next value sample by sample and multiplies one sample at a time. This keeps its own linear
+//ramp instead: every point of the ramp only depends on its index, so the whole ramp for a
+//block is filled in one vectorisable loop and each channel is multiplied by it with
+//FloatVectorOperations. A settled gain is one vector multiply per channel, and unity is free.
+//
+//Has prepare/reset/process so it can sit in a juce::dsp::ProcessorChain.
+template <typename SampleType>
+class SmoothedGain {
+public:
+    SmoothedGain() = default;
+
+    void setGainDecibels(SampleType newGainDecibels) noexcept {
+        setGainLinear(juce::Decibels::decibelsToGain(newGainDecibels));
+    }
+
+    //No allocation, fine to call from processBlock
+    void setGainLinear(SampleType newGain) noexcept {
+        if (newGain == target)
+            return;
+
+        target = newGain;
+
+        if (rampLengthSamples <= 0) {
+            current = target;
+            stepsRemaining = 0;
+            return;
+        }
+
+        stepsRemaining = rampLengthSamples;
+        step = (target - current) / static_cast<SampleType>(stepsRemaining);
+    }
+
+    void setRampDurationSeconds(double newDurationSeconds) noexcept {
+        rampSeconds = newDurationSeconds;
+        rampLengthSamples = (int)std::floor(rampSeconds * sampleRate);
+    }
+
+    bool isSmoothing() const noexcept { return stepsRemaining > 0; }
+
+    //Allocates the ramp buffer, so never call this from processBlock
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        sampleRate = spec.sampleRate;
+        setRampDurationSeconds(rampSeconds);
+        ramp.calloc((size_t)spec.maximumBlockSize);
+        maxBlockSize = (int)spec.maximumBlockSize;
+        reset();
+    }
+
+    void reset() noexcept {
+        current = target;
+        stepsRemaining = 0;
+    }
+
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept {
+        auto& block = context.getOutputBlock();
+        auto numChannels = block.getNumChannels();
+        auto numSamples = (int)block.getNumSamples();
+
+        jassert(numSamples <= maxBlockSize);
+
+        if (context.isBypassed)
+            return;
+
+        if (!isSmoothing()) {
+            if (current != SampleType(1))
+                block.multiplyBy(current);
+            return;
+        }
+
+        //current + step * n for the rest of the ramp, then the target. No sample depends on the
+        //previous one, so the compiler turns this into SIMD.
+        auto rampSamples = juce::jmin(numSamples, stepsRemaining);
+        auto* gains = ramp.get();
+        auto start = current;
+        auto increment = step;
+
+        for (int i = 0; i < rampSamples; ++i)
+            gains[i] = start + increment * static_cast<SampleType>(i + 1);
+
+        for (int i = rampSamples; i < numSamples; ++i)
+            gains[i] = target;
+
+        stepsRemaining -= rampSamples;
+        current = stepsRemaining > 0 ? gains[rampSamples - 1] : target;
+
+        for (size_t c = 0; c < numChannels; ++c)
+            juce::FloatVectorOperations::multiply(block.getChannelPointer(c), gains, numSamples);
+    }
+
+private:
+    SampleType current{ 1 }, target{ 1 }, step{ 0 };
+    int stepsRemaining{ 0 }, rampLengthSamples{ 0 };
+
+    double sampleRate{ 44100.0 }, rampSeconds{ 0.05 };
+
+    juce::HeapBlock<SampleType> ramp;
+    int maxBlockSize{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SmoothedGain)
+};
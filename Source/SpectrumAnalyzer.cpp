@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyzer.h"
+#include "RealtimeSafety.h"
+
+SpectrumAnalyzer::SpectrumAnalyzer()
+    : window((size_t)fftSize), fftData((size_t)fftSize * 2) {
+    juce::dsp::WindowingFunction<float>::fillWindowingTables(window.data(), (size_t)fftSize,
+        juce::dsp::WindowingFunction<float>::hann, false);
+
+    for (auto& tap : taps)
+        tap.smoothed.fill(floorDecibels);
+}
+
+void SpectrumAnalyzer::analyse() {
+    auto sampleRate = currentSampleRate.load(std::memory_order_relaxed);
+    if (sampleRate != mappedSampleRate)
+        rebuildBinMapping(sampleRate);
+
+    //Both taps are pushed from the same blocks, so they always hold about the same amount
+    int newSamples = 0;
+
+    for (auto& tap : taps) {
+        auto numReady = tap.fifo.getNumReady();
+        if (numReady == 0)
+            continue;
+
+        //Only the newest fftSize samples can end up in a frame, skip straight past the rest
+        if (numReady > fftSize) {
+            tap.fifo.finishedRead(numReady - fftSize);
+            numReady = fftSize;
+        }
+
+        int start1, size1, start2, size2;
+        tap.fifo.prepareToRead(numReady, start1, size1, start2, size2);
+
+        auto& history = tap.history;
+        std::copy(history.begin() + numReady, history.end(), history.begin());
+
+        auto destination = history.end() - numReady;
+        destination = std::copy(tap.queue.begin() + start1, tap.queue.begin() + start1 + size1, destination);
+        std::copy(tap.queue.begin() + start2, tap.queue.begin() + start2 + size2, destination);
+
+        tap.fifo.finishedRead(size1 + size2);
+        newSamples = juce::jmax(newSamples, numReady);
+    }
+
+    pendingSamples += newSamples;
+    if (pendingSamples < hopSize)
+        return;
+
+    //However far behind we are, one frame of the newest audio is all that's worth drawing
+    pendingSamples = 0;
+
+    auto& spectrum = spectra.getWriteBuffer();
+    for (size_t t = 0; t < taps.size(); ++t)
+        analyseTap(taps[t], spectrum.decibels[t]);
+
+    spectra.publish();
+}
+
+void SpectrumAnalyzer::analyseTap(TapState& tap, std::array<float, numPoints>& destination) {
+    juce::FloatVectorOperations::multiply(fftData.data(), tap.history.data(), window.data(), fftSize);
+    std::fill(fftData.begin() + fftSize, fftData.end(), 0.f);
+    fft.performFrequencyOnlyForwardTransform(fftData.data(), true);
+
+    //A full scale sine reads 0dB: the Hann window halves the amplitude and the FFT sums
+    //fftSize / 2 of them into each half of the spectrum
+    constexpr float normalisation = 4.f / (float)fftSize;
+
+    for (size_t i = 0; i < (size_t)numPoints; ++i) {
+        const auto& point = mapping[i];
+        float magnitude;
+
+        if (point.interpolate) {
+            magnitude = juce::jmap(point.fraction, fftData[(size_t)point.firstBin], fftData[(size_t)point.lastBin]);
+        }
+        else {
+            magnitude = 0.f;
+            for (int bin = point.firstBin; bin <= point.lastBin; ++bin)
+                magnitude = juce::jmax(magnitude, fftData[(size_t)bin]);
+        }
+
+        auto decibels = juce::Decibels::gainToDecibels(magnitude * normalisation, floorDecibels);
+        auto& smoothed = tap.smoothed[i];
+        smoothed += (decibels - smoothed) * (decibels > smoothed ? attack : release);
+        destination[i] = smoothed;
+    }
+}
+
+void SpectrumAnalyzer::rebuildBinMapping(double sampleRate) {
+    mappedSampleRate = sampleRate;
+
+    auto binWidth = (float)(sampleRate / fftSize);
+    constexpr int lastBin = fftSize / 2;
+
+    for (int i = 0; i < numPoints; ++i) {
+        auto& point = mapping[(size_t)i];
+        auto frequency = getPointFrequency(i);
+
+        //Each point covers the range halfway (in log frequency) to its neighbours
+        auto lower = std::sqrt(frequency * getPointFrequency(juce::jmax(i - 1, 0)));
+        auto upper = std::sqrt(frequency * getPointFrequency(juce::jmin(i + 1, numPoints - 1)));
+
+        if ((upper - lower) < binWidth) {
+            auto exactBin = juce::jmin(frequency / binWidth, (float)lastBin);
+            point.firstBin = juce::jmin((int)exactBin, lastBin - 1);
+            point.lastBin = point.firstBin + 1;
+            point.fraction = exactBin - (float)point.firstBin;
+            point.interpolate = true;
+        }
+        else {
+            point.firstBin = juce::jlimit(0, lastBin, juce::roundToInt(lower / binWidth));
+            point.lastBin = juce::jlimit(point.firstBin, lastBin, juce::roundToInt(upper / binWidth));
+            point.fraction = 0.f;
+            point.interpolate = false;
+        }
+    }
+}
+
+//==============================================================================
+SpectrumAnalyzerThread::SpectrumAnalyzerThread() : juce::Thread("WeirdEffects Spectrum Analyzer") {
+    startThread(juce::Thread::Priority::low);
+}
+
+SpectrumAnalyzerThread::~SpectrumAnalyzerThread() {
+    stopThread(4000);
+}
+
+void SpectrumAnalyzerThread::add(SpectrumAnalyzer* analyzer) {
+    const RealtimeSafety::ScopedLock lock(clientLock);
+    clients.addIfNotAlreadyThere(analyzer);
+}
+
+void SpectrumAnalyzerThread::remove(SpectrumAnalyzer* analyzer) {
+    const RealtimeSafety::ScopedLock lock(clientLock);
+    clients.removeFirstMatchingValue(analyzer);
+}
+
+void SpectrumAnalyzerThread::run() {
+    while (!threadShouldExit()) {
+        {
+            const RealtimeSafety::ScopedLock lock(clientLock);
+            for (auto* client : clients)
+                client->analyse();
+        }
+
+        wait(intervalMilliseconds);
+    }
+}
@@ -0,0 +1,179 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.h
+
+    Pre/post spectrum of the processor, analysed off the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "TripleBuffer.h"
+
+//Owned by the processor. processBlock pushes a mono mix of its input and output into two wait-free
+//FIFOs, the shared SpectrumAnalyzerThread drains them, runs the FFTs and smoothing and publishes
+//a finished spectrum that the editor picks up through a TripleBuffer. The audio thread only ever
+//copies samples and never waits on anyone: if nobody drains the FIFO it just drops samples.
+//
+//While no editor is attached push() returns straight away, so a closed editor costs nothing.
+class SpectrumAnalyzer {
+public:
+    enum Tap {
+        Pre,
+        Post,
+        NumTaps,
+    };
+
+    static constexpr int fftOrder = 11;
+    static constexpr int fftSize = 1 << fftOrder;
+
+    //The spectrum is handed over already reduced to this many log spaced frequencies, so
+    //drawing never touches the 1024 FFT bins
+    static constexpr int numPoints = 256;
+    static constexpr float minFrequency = 20.f;
+    static constexpr float maxFrequency = 20000.f;
+    static constexpr float floorDecibels = -100.f;
+
+    //Smoothed level in dB at getPointFrequency(i), one array per tap
+    struct Spectrum {
+        Spectrum() noexcept { for (auto& tap : decibels) tap.fill(floorDecibels); }
+
+        std::array<std::array<float, numPoints>, NumTaps> decibels;
+    };
+
+    SpectrumAnalyzer();
+
+    static float getPointFrequency(int index) noexcept {
+        return minFrequency * std::pow(maxFrequency / minFrequency, (float)index / (float)(numPoints - 1));
+    }
+
+    //prepareToPlay. The analyser thread rebuilds its bin mapping the next time it runs.
+    void prepare(double sampleRate) noexcept { currentSampleRate.store(sampleRate, std::memory_order_relaxed); }
+
+    //Audio thread. Mixes the first numChannels channels down to mono and queues them, dropping
+    //whatever doesn't fit. Takes a block so the processor can push any part of a buffer.
+    template <typename SampleType>
+    void push(Tap tap, const juce::dsp::AudioBlock<SampleType>& block, int numChannels) noexcept;
+
+    bool isActive() const noexcept { return attachedDisplays.load(std::memory_order_relaxed) > 0; }
+
+    //Message thread, by the display showing this analyser. Only one display reads at a time.
+    void attach() noexcept { attachedDisplays.fetch_add(1, std::memory_order_relaxed); }
+    void detach() noexcept { attachedDisplays.fetch_sub(1, std::memory_order_relaxed); }
+
+    //Display side. Returns true if a new spectrum was published since the last call.
+    bool pullSpectrum() noexcept { return spectra.update(); }
+    const Spectrum& getSpectrum() const noexcept { return spectra.getReadBuffer(); }
+
+    //Analyser thread. Drains both FIFOs and publishes a new spectrum once there's enough new
+    //audio for another FFT frame. Does nothing if no new samples arrived.
+    void analyse();
+
+private:
+    //How far the window moves between frames, a quarter of the FFT
+    static constexpr int hopSize = fftSize / 4;
+    //Samples queued per tap, enough for ~80ms at 192kHz if the analyser thread is late
+    static constexpr int fifoCapacity = 8 * fftSize;
+    //Per frame smoothing of the dB values. Peaks show up almost straight away and fall back
+    //slowly, like a meter, so the curve doesn't flicker.
+    static constexpr float attack = 0.7f;
+    static constexpr float release = 0.15f;
+
+    struct TapState {
+        juce::AbstractFifo fifo{ fifoCapacity };
+        std::vector<float> queue = std::vector<float>((size_t)fifoCapacity);
+
+        //Analyser thread only from here on. The most recent fftSize samples, oldest first.
+        std::vector<float> history = std::vector<float>((size_t)fftSize);
+        std::array<float, numPoints> smoothed;
+    };
+
+    void rebuildBinMapping(double sampleRate);
+    void analyseTap(TapState& tap, std::array<float, numPoints>& destination);
+
+    std::atomic<double> currentSampleRate{ 44100.0 };
+    std::atomic<int> attachedDisplays{ 0 };
+
+    std::array<TapState, NumTaps> taps;
+    TripleBuffer<Spectrum> spectra;
+
+    //Analyser thread only
+    juce::dsp::FFT fft{ fftOrder };
+    std::vector<float> window, fftData;
+    int pendingSamples{ 0 };
+    double mappedSampleRate{ 0 };
+
+    //Every point either reads between two bins (low end, narrower than a bin) or takes the
+    //loudest of the bins around it (high end, many bins per point)
+    struct PointMapping {
+        int firstBin{ 0 }, lastBin{ 0 };
+        float fraction{ 0 };
+        bool interpolate{ true };
+    };
+    std::array<PointMapping, numPoints> mapping;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyzer)
+};
+
+//One thread for every open analyser display, however many plugin instances are showing one.
+//Held by the displays through a SharedResourcePointer, so it only exists while one is open.
+class SpectrumAnalyzerThread : public juce::Thread {
+public:
+    SpectrumAnalyzerThread();
+    ~SpectrumAnalyzerThread() override;
+
+    //Message thread. Once remove() returns the thread won't touch that analyser again.
+    void add(SpectrumAnalyzer* analyzer);
+    void remove(SpectrumAnalyzer* analyzer);
+
+    void run() override;
+
+private:
+    //About as often as the displays repaint, there's nothing to gain from analysing faster
+    static constexpr int intervalMilliseconds = 16;
+
+    juce::CriticalSection clientLock;
+    juce::Array<SpectrumAnalyzer*> clients;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumAnalyzerThread)
+};
+
+template <typename SampleType>
+void SpectrumAnalyzer::push(Tap tap, const juce::dsp::AudioBlock<SampleType>& block, int numChannels) noexcept {
+    numChannels = juce::jmin(numChannels, (int)block.getNumChannels());
+    if (!isActive() || numChannels <= 0)
+        return;
+
+    auto& state = taps[(size_t)tap];
+    auto numSamples = (int)block.getNumSamples();
+
+    int start1, size1, start2, size2;
+    state.fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    //Plain average of every channel, which is what a mono fold-down sounds like
+    auto gain = static_cast<SampleType>(1) / static_cast<SampleType>(numChannels);
+    auto mixDown = [&](int destinationStart, int sourceStart, int length) {
+        auto* destination = state.queue.data() + destinationStart;
+
+        //Channel by channel so every pass is a straight vectorisable loop
+        for (int c = 0; c < numChannels; ++c) {
+            auto* source = block.getChannelPointer((size_t)c) + sourceStart;
+
+            if (c == 0) {
+                for (int i = 0; i < length; ++i)
+                    destination[i] = static_cast<float>(source[i] * gain);
+            }
+            else {
+                for (int i = 0; i < length; ++i)
+                    destination[i] += static_cast<float>(source[i] * gain);
+            }
+        }
+    };
+
+    mixDown(start1, 0, size1);
+    mixDown(start2, size1, size2);
+    state.fifo.finishedWrite(size1 + size2);
+}
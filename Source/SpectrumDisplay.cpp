@@ -0,0 +1,126 @@
+/*
+  ==============================================================================
+
+    SpectrumDisplay.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrumDisplay.h"
+
+SpectrumDisplay::SpectrumDisplay(SpectrumAnalyzer& analyzerToShow) : analyzer(analyzerToShow) {
+    //Nothing is pushed by the audio thread until a display is attached
+    analyzer.attach();
+    analyzerThread->add(&analyzer);
+
+    setOpaque(true);
+    startTimerHz(30);
+}
+
+SpectrumDisplay::~SpectrumDisplay() {
+    stopTimer();
+    analyzerThread->remove(&analyzer);
+    analyzer.detach();
+}
+
+void SpectrumDisplay::paint(juce::Graphics& g) {
+    //Rendered at the display's scale factor, so it's drawn into our bounds rather than 1:1
+    g.drawImage(grid, getLocalBounds().toFloat());
+
+    g.setColour(juce::Colours::lightgrey.withAlpha(0.25f));
+    g.fillPath(preFill);
+
+    g.setColour(juce::Colours::orange);
+    g.strokePath(postLine, juce::PathStrokeType(1.5f));
+}
+
+void SpectrumDisplay::resized() {
+    auto width = (float)getWidth();
+    for (int i = 0; i < SpectrumAnalyzer::numPoints; ++i)
+        pointX[(size_t)i] = width * (float)i / (float)(SpectrumAnalyzer::numPoints - 1);
+
+    rebuildGrid();
+    rebuildPaths();
+}
+
+void SpectrumDisplay::timerCallback() {
+    //Nothing new means nothing to redraw, so idle editors cost next to nothing
+    if (!analyzer.pullSpectrum())
+        return;
+
+    rebuildPaths();
+    repaint();
+}
+
+void SpectrumDisplay::rebuildPaths() {
+    const auto& spectrum = analyzer.getSpectrum();
+    const auto& pre = spectrum.decibels[SpectrumAnalyzer::Pre];
+    const auto& post = spectrum.decibels[SpectrumAnalyzer::Post];
+    auto bottom = (float)getHeight();
+
+    preFill.clear();
+    postLine.clear();
+    preFill.preallocateSpace(SpectrumAnalyzer::numPoints * 3 + 9);
+    postLine.preallocateSpace(SpectrumAnalyzer::numPoints * 3 + 3);
+
+    preFill.startNewSubPath(0.f, bottom);
+    postLine.startNewSubPath(pointX[0], decibelsToY(post[0]));
+
+    //Points closer than a pixel to the last one drawn are skipped, small editors get fewer segments
+    auto lastX = -1.f;
+    for (size_t i = 0; i < pointX.size(); ++i) {
+        auto x = pointX[i];
+        if (x - lastX < 1.f && i + 1 < pointX.size())
+            continue;
+
+        lastX = x;
+        preFill.lineTo(x, decibelsToY(pre[i]));
+        if (i > 0)
+            postLine.lineTo(x, decibelsToY(post[i]));
+    }
+
+    preFill.lineTo((float)getWidth(), bottom);
+    preFill.closeSubPath();
+}
+
+void SpectrumDisplay::rebuildGrid() {
+    if (getWidth() <= 0 || getHeight() <= 0) {
+        grid = {};
+        return;
+    }
+
+    auto scale = juce::Component::getApproximateScaleFactorForComponent(this);
+    grid = juce::Image(juce::Image::RGB, juce::roundToInt((float)getWidth() * scale), juce::roundToInt((float)getHeight() * scale), true);
+
+    juce::Graphics g(grid);
+    g.addTransform(juce::AffineTransform::scale(scale));
+    g.fillAll(juce::Colours::black);
+
+    auto width = (float)getWidth();
+    auto height = (float)getHeight();
+    auto logRange = std::log(SpectrumAnalyzer::maxFrequency / SpectrumAnalyzer::minFrequency);
+
+    g.setFont(11.f);
+    for (auto frequency : { 50.f, 100.f, 200.f, 500.f, 1000.f, 2000.f, 5000.f, 10000.f }) {
+        auto x = width * std::log(frequency / SpectrumAnalyzer::minFrequency) / logRange;
+        g.setColour(juce::Colours::dimgrey);
+        g.drawVerticalLine(juce::roundToInt(x), 0.f, height);
+
+        g.setColour(juce::Colours::grey);
+        auto label = frequency >= 1000.f ? juce::String(frequency / 1000.f) + "k" : juce::String(frequency);
+        g.drawText(label, juce::roundToInt(x) + 2, (int)height - 14, 40, 12, juce::Justification::left);
+    }
+
+    for (auto decibels = 0.f; decibels > bottomDecibels; decibels -= 12.f) {
+        auto y = decibelsToY(decibels);
+        g.setColour(juce::Colours::dimgrey);
+        g.drawHorizontalLine(juce::roundToInt(y), 0.f, width);
+
+        g.setColour(juce::Colours::grey);
+        g.drawText(juce::String(decibels) + "dB", 2, juce::roundToInt(y) + 1, 40, 12, juce::Justification::left);
+    }
+}
+
+float SpectrumDisplay::decibelsToY(float decibels) const noexcept {
+    return juce::jmap(juce::jlimit(bottomDecibels, topDecibels, decibels), bottomDecibels, topDecibels, (float)getHeight(), 0.f);
+}
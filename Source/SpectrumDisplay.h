@@ -0,0 +1,51 @@
+/*
+  ==============================================================================
+
+    SpectrumDisplay.h
+
+    Editor component drawing the processor's pre/post spectrum.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "SpectrumAnalyzer.h"
+
+//Draws the input spectrum as a filled shape behind the output spectrum as a line. The paths
+//are only rebuilt when the analyser publishes a new spectrum, and the grid is rendered once
+//per size into an image, so repaints just blit the image and stroke two cached paths.
+class SpectrumDisplay : public juce::Component,
+                        private juce::Timer {
+public:
+    explicit SpectrumDisplay(SpectrumAnalyzer& analyzerToShow);
+    ~SpectrumDisplay() override;
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+
+    //Turns the latest spectrum into preFill/postLine for the current size
+    void rebuildPaths();
+    void rebuildGrid();
+
+    //Range shown on the y axis
+    static constexpr float topDecibels = 6.f;
+    static constexpr float bottomDecibels = -90.f;
+
+    float decibelsToY(float decibels) const noexcept;
+
+    SpectrumAnalyzer& analyzer;
+    juce::SharedResourcePointer<SpectrumAnalyzerThread> analyzerThread;
+
+    //x position of every spectrum point, updated on resize
+    std::array<float, SpectrumAnalyzer::numPoints> pointX;
+
+    juce::Image grid;
+    juce::Path preFill, postLine;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumDisplay)
+};
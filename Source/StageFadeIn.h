@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    StageFadeIn.h
+
+    Crossfade from a stage's input to its output when it rejoins the chain.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//A stage taken out of the chain (see the processor's stage pruning) comes back with stale or
+//cleared state, so switching straight to its output can click. This keeps a copy of what went
+//into the stage and fades linearly from that to what came out over a short ramp.
+//
+//Costs nothing outside the ramp: pushInput and mixOutput return straight away.
+template <typename SampleType>
+class StageFadeIn {
+public:
+    StageFadeIn() = default;
+
+    //Allocates the copy of the input, so never call this from processBlock
+    void prepare(const juce::dsp::ProcessSpec& spec, double fadeSeconds) {
+        input.setSize((int)spec.numChannels, (int)spec.maximumBlockSize);
+        fadeLength = juce::jmax(1, juce::roundToInt(fadeSeconds * spec.sampleRate));
+        reset();
+    }
+
+    void reset() noexcept { remaining = 0; }
+
+    //Starts the ramp at the next block
+    void start() noexcept { remaining = fadeLength; }
+
+    bool isFading() const noexcept { return remaining > 0; }
+
+    //Before the stage runs
+    void pushInput(const juce::dsp::AudioBlock<SampleType>& block) noexcept {
+        if (!isFading())
+            return;
+
+        auto channels = juce::jmin((int)block.getNumChannels(), input.getNumChannels());
+        auto numSamples = juce::jmin((int)block.getNumSamples(), input.getNumSamples());
+
+        for (int c = 0; c < channels; ++c)
+            juce::FloatVectorOperations::copy(input.getWritePointer(c), block.getChannelPointer((size_t)c), numSamples);
+    }
+
+    //After the stage ran on the same block
+    void mixOutput(juce::dsp::AudioBlock<SampleType>& block) noexcept {
+        if (!isFading())
+            return;
+
+        auto channels = juce::jmin((int)block.getNumChannels(), input.getNumChannels());
+        auto numSamples = juce::jmin((int)block.getNumSamples(), input.getNumSamples());
+        auto done = fadeLength - remaining;
+
+        for (int c = 0; c < channels; ++c) {
+            auto* dry = input.getReadPointer(c);
+            auto* samples = block.getChannelPointer((size_t)c);
+
+            for (int i = 0; i < numSamples; ++i) {
+                auto amount = static_cast<SampleType>(juce::jmin(done + i + 1, fadeLength)) / static_cast<SampleType>(fadeLength);
+                samples[i] = dry[i] + amount * (samples[i] - dry[i]);
+            }
+        }
+
+        remaining = juce::jmax(0, remaining - numSamples);
+    }
+
+private:
+    juce::AudioBuffer<SampleType> input;
+    int fadeLength{ 1 }, remaining{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StageFadeIn)
+};
@@ -0,0 +1,240 @@
+/*
+  ==============================================================================
+
+    StateVariableCascade.h
+
+    LowCut + HighCut as TPT state variable filters with per-sample cutoff.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CutFilterDesign.h"
+
+//The "State Variable" cut mode. Same Butterworth slopes as BiquadCascade (one 2 pole section
+//per 12dB/Oct, with the same Q per section), but built from topology-preserving transform
+//state variable filters, whose state stays valid whatever the cutoff does. That makes it safe
+//to move the cutoff every sample, which is what the LFO and envelope in CutModulator do.
+//
+//Moving the cutoff costs no design maths: g = tan(pi * f / fs) comes from a table indexed by
+//octaves above minFrequency, so a modulation offset in octaves is just added to the table
+//position, and the three section coefficients are one division and two multiplies. They are
+//worked out once per sample for the whole block and shared by every channel.
+template <typename SampleType>
+class StateVariableCascade {
+public:
+    //3 LowCut sections followed by 3 HighCut sections. Like BiquadCascade every section has a
+    //fixed slot (LowCut 0-2, HighCut 3-5), so a slope change never moves a section onto
+    //another one's state.
+    static constexpr int maxSections = 2 * CutCoefficients::maxSections;
+    static constexpr int firstHighCutSlot = CutCoefficients::maxSections;
+
+    //The table runs from here up to just below nyquist, so modulation can go past 20Hz-20kHz
+    static constexpr float minFrequency = 10.f;
+    static constexpr int pointsPerOctave = 64;
+
+    StateVariableCascade() = default;
+
+    //Builds the tan() table and allocates the per-sample coefficients and the filter state,
+    //so never call this from processBlock
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        numChannels = (int)spec.numChannels;
+        maxBlockSize = (int)spec.maximumBlockSize;
+
+        auto maxFrequency = 0.49 * spec.sampleRate;
+        numTablePoints = juce::jmax(2, (int)std::ceil(std::log2(maxFrequency / minFrequency) * pointsPerOctave) + 1);
+        gTable.resize((size_t)numTablePoints);
+
+        for (int i = 0; i < numTablePoints; ++i) {
+            auto frequency = juce::jmin(minFrequency * std::exp2((double)i / pointsPerOctave), maxFrequency);
+            gTable[(size_t)i] = static_cast<SampleType>(std::tan(juce::MathConstants<double>::pi * frequency / spec.sampleRate));
+        }
+
+        //a1, a2, a3 for every section and every sample of a block
+        coefficients.resize((size_t)(maxSections * 3 * maxBlockSize));
+        ic1eq.resize((size_t)(numChannels * maxSections));
+        ic2eq.resize((size_t)(numChannels * maxSections));
+
+        //Positions are in octaves * pointsPerOctave, so linear smoothing glides evenly in octaves
+        lowCutPosition.reset(spec.sampleRate, smoothingSeconds);
+        highCutPosition.reset(spec.sampleRate, smoothingSeconds);
+
+        reset();
+    }
+
+    void reset() noexcept {
+        std::fill(ic1eq.begin(), ic1eq.end(), SampleType(0));
+        std::fill(ic2eq.begin(), ic2eq.end(), SampleType(0));
+    }
+
+    //New cut frequencies and slopes. The frequencies glide, slopes switch straight away.
+    //A couple of log2/cos calls, fine on the audio thread when a parameter moved. A slot that
+    //comes back after a slope change starts from silence rather than its old state.
+    void setTargets(float lowCutFrequency, int lowSections, float highCutFrequency, int highSections) noexcept {
+        lowCutPosition.setTargetValue(getTablePosition(lowCutFrequency));
+        highCutPosition.setTargetValue(getTablePosition(highCutFrequency));
+
+        if (lowSections != numLowSections) {
+            for (int s = numLowSections; s < lowSections; ++s)
+                clearSlot(s);
+
+            numLowSections = lowSections;
+            for (int s = 0; s < numLowSections; ++s)
+                damping[(size_t)s] = static_cast<SampleType>(1.0 / CutFilterDesign::getButterworthQ(s, numLowSections));
+        }
+
+        if (highSections != numHighSections) {
+            for (int s = numHighSections; s < highSections; ++s)
+                clearSlot(firstHighCutSlot + s);
+
+            numHighSections = highSections;
+            for (int s = 0; s < numHighSections; ++s)
+                damping[(size_t)(firstHighCutSlot + s)] = static_cast<SampleType>(1.0 / CutFilterDesign::getButterworthQ(s, numHighSections));
+        }
+    }
+
+    //Still on its way to the last targets
+    bool isGliding() const noexcept { return lowCutPosition.isSmoothing() || highCutPosition.isSmoothing(); }
+
+    //Jumps to the targets without gliding, for after prepare()
+    void snapToTargets() noexcept {
+        lowCutPosition.setCurrentAndTargetValue(lowCutPosition.getTargetValue());
+        highCutPosition.setCurrentAndTargetValue(highCutPosition.getTargetValue());
+    }
+
+    //octaveOffsets moves both cutoffs by that many octaves at each sample, or nullptr for none
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context, const float* octaveOffsets) noexcept {
+        auto& block = context.getOutputBlock();
+        auto channels = juce::jmin((int)block.getNumChannels(), numChannels);
+        auto numSamples = (int)block.getNumSamples();
+
+        jassert(numSamples <= maxBlockSize);
+
+        if (context.isBypassed || channels == 0) {
+            lowCutPosition.skip(numSamples);
+            highCutPosition.skip(numSamples);
+            return;
+        }
+
+        updateCoefficients(numSamples, octaveOffsets);
+
+        for (int c = 0; c < channels; ++c) {
+            auto* samples = block.getChannelPointer((size_t)c);
+
+            //A whole block through one section at a time keeps the two states in registers
+            for (int slot = 0; slot < numLowSections; ++slot) {
+                auto& state1 = ic1eq[(size_t)(c * maxSections + slot)];
+                auto& state2 = ic2eq[(size_t)(c * maxSections + slot)];
+                auto z1 = state1, z2 = state2;
+
+                auto* a1 = getCoefficients(slot, 0);
+                auto* a2 = getCoefficients(slot, 1);
+                auto* a3 = getCoefficients(slot, 2);
+                auto k = damping[(size_t)slot];
+
+                for (int i = 0; i < numSamples; ++i) {
+                    auto v0 = samples[i];
+                    auto v3 = v0 - z2;
+                    auto v1 = a1[i] * z1 + a2[i] * v3;
+                    auto v2 = z2 + a2[i] * z1 + a3[i] * v3;
+                    z1 = SampleType(2) * v1 - z1;
+                    z2 = SampleType(2) * v2 - z2;
+                    samples[i] = v0 - k * v1 - v2;
+                }
+
+                state1 = z1;
+                state2 = z2;
+            }
+
+            for (int slot = firstHighCutSlot; slot < firstHighCutSlot + numHighSections; ++slot) {
+                auto& state1 = ic1eq[(size_t)(c * maxSections + slot)];
+                auto& state2 = ic2eq[(size_t)(c * maxSections + slot)];
+                auto z1 = state1, z2 = state2;
+
+                auto* a1 = getCoefficients(slot, 0);
+                auto* a2 = getCoefficients(slot, 1);
+                auto* a3 = getCoefficients(slot, 2);
+
+                for (int i = 0; i < numSamples; ++i) {
+                    auto v3 = samples[i] - z2;
+                    auto v1 = a1[i] * z1 + a2[i] * v3;
+                    auto v2 = z2 + a2[i] * z1 + a3[i] * v3;
+                    z1 = SampleType(2) * v1 - z1;
+                    z2 = SampleType(2) * v2 - z2;
+                    samples[i] = v2;
+                }
+
+                state1 = z1;
+                state2 = z2;
+            }
+        }
+    }
+
+private:
+    float getTablePosition(float frequency) const noexcept {
+        return std::log2(juce::jmax(frequency, minFrequency) / minFrequency) * (float)pointsPerOctave;
+    }
+
+    //Linear interpolation between table points, clamped to the table's range
+    SampleType lookupG(float position) const noexcept {
+        position = juce::jlimit(0.f, (float)(numTablePoints - 1), position);
+        auto index = juce::jmin((int)position, numTablePoints - 2);
+        auto fraction = static_cast<SampleType>(position - (float)index);
+        return gTable[(size_t)index] + fraction * (gTable[(size_t)index + 1] - gTable[(size_t)index]);
+    }
+
+    SampleType* getCoefficients(int slot, int which) noexcept {
+        return coefficients.data() + (size_t)((slot * 3 + which) * maxBlockSize);
+    }
+
+    void clearSlot(int slot) noexcept {
+        for (int c = 0; c < numChannels; ++c) {
+            ic1eq[(size_t)(c * maxSections + slot)] = SampleType(0);
+            ic2eq[(size_t)(c * maxSections + slot)] = SampleType(0);
+        }
+    }
+
+    void setSectionCoefficients(int slot, int i, SampleType g) noexcept {
+        auto a1 = SampleType(1) / (SampleType(1) + g * (g + damping[(size_t)slot]));
+        auto a2 = g * a1;
+
+        getCoefficients(slot, 0)[i] = a1;
+        getCoefficients(slot, 1)[i] = a2;
+        getCoefficients(slot, 2)[i] = g * a2;
+    }
+
+    void updateCoefficients(int numSamples, const float* octaveOffsets) noexcept {
+        for (int i = 0; i < numSamples; ++i) {
+            auto offset = octaveOffsets != nullptr ? octaveOffsets[i] * (float)pointsPerOctave : 0.f;
+            auto lowG = lookupG(lowCutPosition.getNextValue() + offset);
+            auto highG = lookupG(highCutPosition.getNextValue() + offset);
+
+            for (int slot = 0; slot < numLowSections; ++slot)
+                setSectionCoefficients(slot, i, lowG);
+            for (int slot = firstHighCutSlot; slot < firstHighCutSlot + numHighSections; ++slot)
+                setSectionCoefficients(slot, i, highG);
+        }
+    }
+
+    //Roughly how long a jump in a cut frequency takes to glide, the same as CoefficientService
+    static constexpr double smoothingSeconds = 0.05;
+
+    std::vector<SampleType> gTable;
+    int numTablePoints{ 0 };
+
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Linear> lowCutPosition, highCutPosition;
+    int numLowSections{ 0 }, numHighSections{ 0 };
+    //k = 1 / Q of every slot
+    std::array<SampleType, maxSections> damping{};
+
+    //Laid out [slot][a1/a2/a3][sample]
+    std::vector<SampleType> coefficients;
+    //Laid out [channel][slot]
+    std::vector<SampleType> ic1eq, ic2eq;
+
+    int numChannels{ 0 }, maxBlockSize{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StateVariableCascade)
+};
@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+
+    Wait-free single writer / single reader handoff of a value.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//The writer fills getWriteBuffer() and calls publish(), the reader calls update() and
+//then reads getReadBuffer(). Neither side ever waits on the other or allocates: the
+//three slots just get swapped around through one atomic index, so the audio thread can
+//always grab the newest complete value while the writer is busy filling the next one.
+//
+//Only one thread may write and only one thread may read at a time.
+template <typename ValueType>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+
+    //Writer side
+    ValueType& getWriteBuffer() noexcept { return buffers[(size_t)writeIndex]; }
+
+    void publish() noexcept {
+        auto previous = middle.exchange(writeIndex | newDataFlag, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    //Reader side. Returns true if a new value was published since the last call.
+    bool update() noexcept {
+        if ((middle.load(std::memory_order_relaxed) & newDataFlag) == 0)
+            return false;
+
+        auto previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    const ValueType& getReadBuffer() const noexcept { return buffers[(size_t)readIndex]; }
+
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int newDataFlag = 4;
+
+    std::array<ValueType, 3> buffers;
+    std::atomic<int> middle{ 1 };
+    int writeIndex{ 0 }, readIndex{ 2 };
+
+    JUCE_DECLARE_NON_COPYABLE(TripleBuffer)
+};
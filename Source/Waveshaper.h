@@ -0,0 +1,547 @@
+/*
+  ==============================================================================
+
+    Waveshaper.h
+
+    Waveshaper and bitcrusher with antiderivative anti-aliasing and oversampling.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "ParameterSnapshot.h"
+#include "RealtimeSafety.h"
+#include "SmoothedGain.h"
+
+//The nonlinear stage after the gain: "Drive" into one of three curves, then bit reduction and
+//sample rate reduction (sample and hold).
+//
+//The curves are first order antiderivative anti-aliased (ADAA). Instead of f(x[n]) the output
+//is (F(x[n]) - F(x[n-1])) / (x[n] - x[n-1]) with F the antiderivative of f, the average of the
+//curve between the two samples, which takes most of the aliasing out of the harmonics it adds.
+//Where two samples are too close together for the division it uses f at their midpoint.
+//
+//F comes from a cubic Hermite table per curve (value and slope at every node), so F and its
+//slope are both continuous and the difference quotient never steps. Looking it up is the same
+//short polynomial for every sample with nothing carried between them, so the whole block goes
+//through it in one loop the compiler vectorises before the serial ADAA pass.
+//
+//Optionally all of it runs at 2, 4 or 8 times the sample rate through juce::dsp::Oversampling,
+//with polyphase IIR or equiripple FIR half band filters, which adds getLatencySamples() of
+//latency. An oversampler for a new setting is built on the message thread (updateOversampling)
+//and handed over like the FDN's delay memory, so the audio thread never allocates.
+//
+//Has prepare/reset/process so it can sit in a juce::dsp::ProcessorChain.
+template <typename SampleType>
+class Waveshaper {
+public:
+    //The dry delay is sized for the longest oversampler latency, 8x linear phase is well under it
+    static constexpr int maxLatencySamples = 1024;
+    static constexpr int maxOversamplingStages = 3;
+    //"Crush Bits" at this or above doesn't quantise
+    static constexpr float maxBits = 24.f;
+
+    struct Parameters {
+        Shape shape{ Shape::Shape_Off };
+        //Into the curve, ignored while the shape is Off
+        float driveDecibels{ 0.f };
+        //Sample and hold period in samples at the host rate, 1 is off
+        float crushRate{ 1.f };
+        //Resolution of the quantiser in bits
+        float crushBits{ maxBits };
+    };
+
+    //Settings that leave the signal as it is
+    static bool isNeutral(const Parameters& parameters) noexcept {
+        return parameters.shape == Shape::Shape_Off && parameters.crushRate <= 1.f && parameters.crushBits >= maxBits;
+    }
+
+    Waveshaper() {
+        tables[Shape::Shape_Tanh].build(-8.0, 8.0, false, logCosh, [](double x) { return std::tanh(x); });
+
+        //Soft on the positive side, clipping at half the level on the negative side. The slopes
+        //match at 0, so the curve stays smooth there.
+        tables[Shape::Shape_Asymmetric].build(-8.0, 8.0, false,
+            [](double x) { return x >= 0.0 ? logCosh(x) : 0.25 * logCosh(2.0 * x); },
+            [](double x) { return x >= 0.0 ? std::tanh(x) : 0.5 * std::tanh(2.0 * x); });
+
+        //Triangle wave through (-1, -1), (1, 1) and (3, -1): anything past full scale folds back.
+        //Its mean is 0, so the antiderivative repeats with it.
+        tables[Shape::Shape_Foldback].build(-1.0, 3.0, true,
+            [](double x) { auto u = x + 1.0; return u < 2.0 ? 0.5 * u * u - u : 3.0 * (u - 2.0) - 0.5 * (u * u - 4.0); },
+            [](double x) { auto u = x + 1.0; return u < 2.0 ? u - 1.0 : 3.0 - u; });
+    }
+
+    ~Waveshaper() {
+        delete incomingStage.exchange(nullptr);
+        delete retiredStage.exchange(nullptr);
+    }
+
+    //Allocates the scratch buffers and builds the oversampler last asked for, so never call this
+    //from processBlock
+    void prepare(const juce::dsp::ProcessSpec& spec) {
+        sampleRate = spec.sampleRate;
+
+        {
+            //The timer may be building one for the old spec
+            const RealtimeSafety::ScopedLock lock(buildLock);
+            numChannels = (int)spec.numChannels;
+            maxBlockSize = (int)spec.maximumBlockSize;
+
+            delete incomingStage.exchange(nullptr);
+            delete retiredStage.exchange(nullptr);
+            builtSetting.store(requestedSetting.load());
+            stage = buildStage(builtSetting.load());
+        }
+
+        drive.prepare(spec);
+        dry.setSize(numChannels, maxBlockSize);
+        dryDelay.prepare(spec);
+        mixRamp.calloc((size_t)maxBlockSize);
+
+        auto maxOversampledSize = (size_t)maxBlockSize << maxOversamplingStages;
+        inputs.resize(maxOversampledSize);
+        antiderivatives.resize(maxOversampledSize);
+        channelStates.resize((size_t)numChannels);
+
+        //10Hz one pole highpass, only for the asymmetric curve's DC offset
+        dcCoefficient = static_cast<SampleType>(1.0 - juce::MathConstants<double>::twoPi * 10.0 / sampleRate);
+
+        setLatency(stage->latency);
+        mix.reset(sampleRate, 0.05);
+
+        reset();
+        setParameters(currentParameters);
+        mix.setCurrentAndTargetValue(mix.getTargetValue());
+    }
+
+    void reset() noexcept {
+        drive.reset();
+        dryDelay.reset();
+        resetShaping();
+    }
+
+    //No allocation, fine to call from processBlock
+    void setParameters(const Parameters& newParameters) noexcept {
+        auto shapeChanged = newParameters.shape != currentParameters.shape;
+        currentParameters = newParameters;
+
+        drive.setGainDecibels(static_cast<SampleType>(newParameters.shape == Shape::Shape_Off ? 0.f : newParameters.driveDecibels));
+        quantiserLevels = static_cast<SampleType>(std::pow(2.0, (double)newParameters.crushBits - 1.0));
+        mix.setTargetValue(isNeutral(newParameters) ? SampleType(0) : SampleType(1));
+
+        //The last antiderivative belongs to the old curve, the next difference needs the new one
+        if (shapeChanged && newParameters.shape != Shape::Shape_Off)
+            for (auto& state : channelStates)
+                state.antiderivative = tables[newParameters.shape].antiderivative(state.input);
+    }
+
+    const Parameters& getParameters() const noexcept { return currentParameters; }
+
+    //Settings neutral and done gliding to the dry signal, so process() has nothing left to do
+    bool isFullyDry() const noexcept {
+        return mix.getTargetValue() == SampleType(0) && !mix.isSmoothing();
+    }
+
+    //Audio thread. Only stores the request, updateOversampling() builds it.
+    void setOversampling(OversamplingFactor factor, OversamplingQuality quality) noexcept {
+        requestedSetting.store((int)factor * numQualities + (int)quality, std::memory_order_relaxed);
+    }
+
+    //Of the oversampler in use. Changes when process() swaps in a new one.
+    int getLatencySamples() const noexcept { return latencySamples; }
+
+    //Offline renders build a requested oversampler inside process() instead of waiting for
+    //updateOversampling(), so the result never depends on the timer
+    void setBuildInline(bool shouldBuildInline) noexcept { buildInline = shouldBuildInline; }
+
+    //Message thread, call it regularly. Frees the oversampler the audio thread let go of and
+    //builds the one last asked for, which process() swaps in at its next block.
+    void updateOversampling() {
+        const RealtimeSafety::ScopedLock lock(buildLock);
+        delete retiredStage.exchange(nullptr, std::memory_order_acq_rel);
+
+        auto wanted = requestedSetting.load(std::memory_order_relaxed);
+        if (wanted != builtSetting.load(std::memory_order_relaxed) && maxBlockSize > 0
+            && incomingStage.load(std::memory_order_acquire) == nullptr) {
+            builtSetting.store(wanted, std::memory_order_relaxed);
+            incomingStage.store(buildStage(wanted).release(), std::memory_order_release);
+        }
+    }
+
+    void process(const juce::dsp::ProcessContextReplacing<SampleType>& context) noexcept {
+        auto& outputBlock = context.getOutputBlock();
+        auto channels = juce::jmin((int)outputBlock.getNumChannels(), numChannels);
+        auto numSamples = (int)outputBlock.getNumSamples();
+
+        jassert(numSamples <= maxBlockSize);
+
+        //Runs while bypassed too, a new oversampling setting doesn't wait for the stage to be used
+        exchangeOversampling();
+
+        if (channels == 0 || numSamples == 0)
+            return;
+
+        auto block = outputBlock.getSubsetChannelBlock(0, (size_t)channels);
+        auto delayed = latencySamples > 0;
+
+        //Pruned. The rest of the chain is lined up with the oversampler's latency, so the signal
+        //still gets delayed by that much.
+        if (context.isBypassed) {
+            if (delayed)
+                delay(block);
+
+            running = false;
+            return;
+        }
+
+        //Back after being bypassed or with a new oversampler: nothing in the filters or the ADAA
+        //history belongs to this signal any more. The mix glides up from the dry signal meanwhile.
+        if (!running) {
+            resetShaping();
+            running = true;
+        }
+
+        //The dry signal to blend with while the mix glides, lined up with the oversampled path.
+        //With latency it's always kept going, so the delay line is full when a glide starts.
+        auto blending = mix.isSmoothing() || mix.getTargetValue() < SampleType(1);
+        auto dryBlock = juce::dsp::AudioBlock<SampleType>(dry).getSubsetChannelBlock(0, (size_t)channels)
+                                                              .getSubBlock(0, (size_t)numSamples);
+        if (blending || delayed) {
+            dryBlock.copyFrom(block);
+            if (delayed)
+                delay(dryBlock);
+        }
+
+        drive.process(juce::dsp::ProcessContextReplacing<SampleType>(block));
+
+        if (stage->oversampler != nullptr) {
+            auto oversampled = stage->oversampler->processSamplesUp(block);
+            shape(oversampled.getSubsetChannelBlock(0, (size_t)channels), stage->factor);
+            stage->oversampler->processSamplesDown(block);
+        }
+        else {
+            shape(block, 1);
+        }
+
+        if (currentParameters.shape == Shape::Shape_Asymmetric)
+            removeDC(block);
+
+        if (blending)
+            mixWithDry(block, dryBlock);
+    }
+
+private:
+    //F and f = F' sampled at evenly spaced nodes, read back with cubic Hermite interpolation.
+    //Kept in double even for float blocks: F grows with the input, and the difference of two
+    //nearly equal large antiderivatives in float would be mostly rounding.
+    class CurveTable {
+    public:
+        //A periodic curve repeats [start, end], anything else carries on in a straight line
+        //past both ends
+        template <typename Antiderivative, typename Curve>
+        void build(double newStart, double newEnd, bool isPeriodic, Antiderivative&& antiderivativeOf, Curve&& curveOf) {
+            start = newStart;
+            end = newEnd;
+            periodic = isPeriodic;
+            step = (end - start) / numIntervals;
+            inverseStep = 1.0 / step;
+            period = end - start;
+            inversePeriod = 1.0 / period;
+
+            values.resize((size_t)numIntervals + 1);
+            slopes.resize((size_t)numIntervals + 1);
+
+            //Slopes are stored per interval rather than per unit, which is what the Hermite basis wants
+            for (int i = 0; i <= numIntervals; ++i) {
+                auto x = start + i * step;
+                values[(size_t)i] = antiderivativeOf(x);
+                slopes[(size_t)i] = curveOf(x) * step;
+            }
+
+            startSlope = curveOf(start);
+            endSlope = curveOf(end);
+        }
+
+        double antiderivative(double x) const noexcept {
+            double t, beyond;
+            auto index = locate(x, t, beyond);
+
+            auto t2 = t * t;
+            auto t3 = t2 * t;
+            auto value = (2.0 * t3 - 3.0 * t2 + 1.0) * values[(size_t)index]
+                       + (t3 - 2.0 * t2 + t) * slopes[(size_t)index]
+                       + (3.0 * t2 - 2.0 * t3) * values[(size_t)index + 1]
+                       + (t3 - t2) * slopes[(size_t)index + 1];
+
+            return value + juce::jmax(beyond, 0.0) * endSlope + juce::jmin(beyond, 0.0) * startSlope;
+        }
+
+        //Slope of antiderivative(), so the midpoint fallback matches the difference quotient
+        double curve(double x) const noexcept {
+            double t, beyond;
+            auto index = locate(x, t, beyond);
+
+            if (beyond > 0.0)
+                return endSlope;
+            if (beyond < 0.0)
+                return startSlope;
+
+            auto t2 = t * t;
+            return ((6.0 * t2 - 6.0 * t) * (values[(size_t)index] - values[(size_t)index + 1])
+                    + (3.0 * t2 - 4.0 * t + 1.0) * slopes[(size_t)index]
+                    + (3.0 * t2 - 2.0 * t) * slopes[(size_t)index + 1]) * inverseStep;
+        }
+
+    private:
+        static constexpr int numIntervals = 1024;
+
+        int locate(double x, double& t, double& beyond) const noexcept {
+            auto inside = periodic ? x - period * std::floor((x - start) * inversePeriod) : juce::jlimit(start, end, x);
+            beyond = periodic ? 0.0 : x - inside;
+
+            auto position = (inside - start) * inverseStep;
+            auto index = juce::jlimit(0, numIntervals - 1, (int)position);
+            t = position - index;
+            return index;
+        }
+
+        std::vector<double> values, slopes;
+        double start{ 0 }, end{ 1 }, step{ 1 }, inverseStep{ 1 }, period{ 1 }, inversePeriod{ 1 };
+        double startSlope{ 0 }, endSlope{ 0 };
+        bool periodic{ false };
+    };
+
+    //log(cosh(x)), the antiderivative of tanh, without cosh overflowing for large x
+    static double logCosh(double x) noexcept {
+        auto magnitude = std::abs(x);
+        return magnitude + std::log1p(std::exp(-2.0 * magnitude)) - juce::MathConstants<double>::ln2;
+    }
+
+    //One oversampler and what it does to the timing. Built on the message thread, handed to the
+    //audio thread whole. No oversampler means running at the host rate.
+    struct OversamplingStage {
+        std::unique_ptr<juce::dsp::Oversampling<SampleType>> oversampler;
+        int factor{ 1 }, latency{ 0 };
+    };
+
+    static constexpr int numQualities = 3;
+
+    std::unique_ptr<OversamplingStage> buildStage(int setting) const {
+        using Oversampler = juce::dsp::Oversampling<SampleType>;
+
+        auto result = std::make_unique<OversamplingStage>();
+        auto stages = juce::jlimit(0, maxOversamplingStages, setting / numQualities);
+        auto quality = static_cast<OversamplingQuality>(setting % numQualities);
+
+        if (stages > 0 && numChannels > 0) {
+            //Polyphase allpass half bands are cheap and low latency but not linear phase, the
+            //equiripple FIRs are both at the cost of more latency. Whole samples of latency either
+            //way, so the dry path and the host can line up with it exactly.
+            auto type = quality == OversamplingQuality::OversamplingQuality_LinearPhase ? Oversampler::filterHalfBandFIREquiripple
+                                                                                        : Oversampler::filterHalfBandPolyphaseIIR;
+            auto maxQuality = quality != OversamplingQuality::OversamplingQuality_LowLatency;
+
+            result->oversampler = std::make_unique<Oversampler>((size_t)numChannels, (size_t)stages, type, maxQuality, true);
+            result->oversampler->initProcessing((size_t)maxBlockSize);
+            result->factor = 1 << stages;
+            result->latency = juce::jmin(maxLatencySamples - 1, juce::roundToInt(result->oversampler->getLatencyInSamples()));
+        }
+
+        return result;
+    }
+
+    //Audio thread side of updateOversampling()
+    void exchangeOversampling() noexcept {
+        if (buildInline && (requestedSetting.load(std::memory_order_relaxed) != builtSetting.load(std::memory_order_relaxed)
+                            || retiredStage.load(std::memory_order_acquire) != nullptr))
+            updateOversampling();
+
+        //The last one handed back hasn't been freed yet, keep going with this one until it has
+        if (retiredStage.load(std::memory_order_acquire) != nullptr)
+            return;
+
+        if (auto* fresh = incomingStage.exchange(nullptr, std::memory_order_acq_rel)) {
+            retiredStage.store(stage.release(), std::memory_order_release);
+            stage.reset(fresh);
+            setLatency(fresh->latency);
+
+            //Starts over from the dry signal instead of jumping in at full level
+            running = false;
+            auto target = mix.getTargetValue();
+            mix.setCurrentAndTargetValue(SampleType(0));
+            mix.setTargetValue(target);
+        }
+    }
+
+    void setLatency(int newLatency) noexcept {
+        latencySamples = newLatency;
+        dryDelay.setDelay(static_cast<SampleType>(newLatency));
+    }
+
+    void resetShaping() noexcept {
+        if (stage != nullptr && stage->oversampler != nullptr)
+            stage->oversampler->reset();
+
+        auto shapeAtZero = currentParameters.shape != Shape::Shape_Off ? tables[currentParameters.shape].antiderivative(0.0) : 0.0;
+        for (auto& state : channelStates)
+            state = { 0.0, shapeAtZero, SampleType(0), SampleType(0), SampleType(0) };
+
+        //The first sample after a reset is held straight away
+        holdPhase = SampleType(1);
+    }
+
+    void delay(juce::dsp::AudioBlock<SampleType>& block) noexcept {
+        for (size_t c = 0; c < block.getNumChannels(); ++c) {
+            auto* samples = block.getChannelPointer(c);
+            for (size_t i = 0; i < block.getNumSamples(); ++i) {
+                dryDelay.pushSample((int)c, samples[i]);
+                samples[i] = dryDelay.popSample((int)c);
+            }
+        }
+    }
+
+    //Curve, quantiser and sample and hold, at factor times the host rate
+    void shape(juce::dsp::AudioBlock<SampleType> block, int factor) noexcept {
+        auto numSamples = (int)block.getNumSamples();
+        auto curveShape = currentParameters.shape;
+        auto quantise = currentParameters.crushBits < maxBits;
+        auto hold = currentParameters.crushRate > 1.f;
+        auto holdStep = static_cast<SampleType>(1.0 / ((double)currentParameters.crushRate * factor));
+        auto endPhase = holdPhase;
+
+        for (size_t c = 0; c < block.getNumChannels(); ++c) {
+            auto* samples = block.getChannelPointer(c);
+            auto& state = channelStates[c];
+
+            if (curveShape != Shape::Shape_Off)
+                applyCurve(tables[curveShape], samples, numSamples, state);
+
+            //Rounds to the nearest level, branch free so it vectorises
+            if (quantise) {
+                auto levels = quantiserLevels;
+                auto inverseLevels = SampleType(1) / levels;
+                for (int i = 0; i < numSamples; ++i)
+                    samples[i] = std::floor(samples[i] * levels + SampleType(0.5)) * inverseLevels;
+            }
+
+            //Every channel takes its new sample at the same moments
+            if (hold) {
+                auto phase = holdPhase;
+                auto held = state.held;
+
+                for (int i = 0; i < numSamples; ++i) {
+                    phase += holdStep;
+                    if (phase >= SampleType(1)) {
+                        phase -= SampleType(1);
+                        held = samples[i];
+                    }
+                    samples[i] = held;
+                }
+
+                state.held = held;
+                endPhase = phase;
+            }
+        }
+
+        holdPhase = endPhase;
+    }
+
+    struct ChannelState {
+        //Last input and its antiderivative, for the next difference quotient
+        double input{ 0 }, antiderivative{ 0 };
+        SampleType held{ 0 }, dcInput{ 0 }, dcOutput{ 0 };
+    };
+
+    void applyCurve(const CurveTable& table, SampleType* samples, int numSamples, ChannelState& state) noexcept {
+        auto* x = inputs.data();
+        auto* antiderivative = antiderivatives.data();
+
+        //Nothing carried from one sample to the next, this is the loop that vectorises
+        for (int i = 0; i < numSamples; ++i) {
+            x[i] = static_cast<double>(samples[i]);
+            antiderivative[i] = table.antiderivative(x[i]);
+        }
+
+        auto previousInput = state.input;
+        auto previousAntiderivative = state.antiderivative;
+
+        for (int i = 0; i < numSamples; ++i) {
+            auto difference = x[i] - previousInput;
+
+            auto output = std::abs(difference) > adaaTolerance ? (antiderivative[i] - previousAntiderivative) / difference
+                                                               : table.curve(0.5 * (x[i] + previousInput));
+            samples[i] = static_cast<SampleType>(output);
+
+            previousInput = x[i];
+            previousAntiderivative = antiderivative[i];
+        }
+
+        state.input = previousInput;
+        state.antiderivative = previousAntiderivative;
+    }
+
+    void removeDC(juce::dsp::AudioBlock<SampleType>& block) noexcept {
+        for (size_t c = 0; c < block.getNumChannels(); ++c) {
+            auto* samples = block.getChannelPointer(c);
+            auto& state = channelStates[c];
+
+            for (size_t i = 0; i < block.getNumSamples(); ++i) {
+                auto output = samples[i] - state.dcInput + dcCoefficient * state.dcOutput;
+                state.dcInput = samples[i];
+                state.dcOutput = output;
+                samples[i] = output;
+            }
+        }
+    }
+
+    void mixWithDry(juce::dsp::AudioBlock<SampleType>& block, const juce::dsp::AudioBlock<SampleType>& dryBlock) noexcept {
+        auto numSamples = (int)block.getNumSamples();
+        auto* amounts = mixRamp.get();
+
+        for (int i = 0; i < numSamples; ++i)
+            amounts[i] = mix.getNextValue();
+
+        for (size_t c = 0; c < block.getNumChannels(); ++c) {
+            auto* samples = block.getChannelPointer(c);
+            auto* drySamples = dryBlock.getChannelPointer(c);
+
+            for (int i = 0; i < numSamples; ++i)
+                samples[i] = drySamples[i] + amounts[i] * (samples[i] - drySamples[i]);
+        }
+    }
+
+    //Closer than this and the difference quotient is mostly rounding
+    static constexpr double adaaTolerance = 1.0e-6;
+
+    std::array<CurveTable, 4> tables;
+
+    Parameters currentParameters;
+    SmoothedGain<SampleType> drive;
+    SampleType quantiserLevels{ 1 }, holdPhase{ 1 }, dcCoefficient{ 0 };
+    std::vector<ChannelState> channelStates;
+    std::vector<double> inputs, antiderivatives;
+
+    //Glides to 0 when the settings go neutral and back up to 1, blending with the dry signal
+    juce::SmoothedValue<SampleType> mix;
+    juce::HeapBlock<SampleType> mixRamp;
+    juce::AudioBuffer<SampleType> dry;
+    juce::dsp::DelayLine<SampleType, juce::dsp::DelayLineInterpolationTypes::None> dryDelay{ maxLatencySamples };
+    bool running{ false };
+
+    //The oversampler in use (audio thread) and the two handover slots, like FDNReverb's memory.
+    //Only prepare() and updateOversampling() build or free them, under buildLock.
+    std::unique_ptr<OversamplingStage> stage;
+    std::atomic<OversamplingStage*> incomingStage{ nullptr }, retiredStage{ nullptr };
+    std::atomic<int> requestedSetting{ 0 }, builtSetting{ -1 };
+    juce::CriticalSection buildLock;
+    bool buildInline{ false };
+    int latencySamples{ 0 };
+
+    double sampleRate{ 44100.0 };
+    int numChannels{ 0 }, maxBlockSize{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Waveshaper)
+};